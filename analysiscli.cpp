@@ -0,0 +1,169 @@
+#include "analysiscli.h"
+#include "taganalyzer.h"
+
+#include <QCommandLineParser>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtConcurrent>
+#include <cstring>
+#include <functional>
+
+namespace {
+
+double percentOf(int minutes, int total)
+{
+    return total > 0 ? minutes * 100.0 / total : 0.0;
+}
+
+// Поле CSV по RFC 4180: кавычки — если есть разделитель, кавычка или перевод строки
+QString csvField(const QString &value)
+{
+    if (!value.contains(QLatin1Char(',')) && !value.contains(QLatin1Char('"'))
+        && !value.contains(QLatin1Char('\n')) && !value.contains(QLatin1Char('\r')))
+        return value;
+    QString quoted = value;
+    quoted.replace(QLatin1String("\""), QLatin1String("\"\""));
+    return QLatin1Char('"') + quoted + QLatin1Char('"');
+}
+
+} // namespace
+
+bool AnalysisCli::isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--analyze") == 0)
+            return true;
+    }
+    return false;
+}
+
+int AnalysisCli::run(const QStringList &arguments)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Отчёт по тегам без GUI"));
+    parser.addHelpOption();
+    const QCommandLineOption analyzeOption(QStringLiteral("analyze"),
+        QStringLiteral("Посчитать отчёт и выйти (без окна)."));
+    const QCommandLineOption fromOption(QStringLiteral("from"),
+        QStringLiteral("Первый день диапазона (yyyy-MM-dd)."), QStringLiteral("date"));
+    const QCommandLineOption toOption(QStringLiteral("to"),
+        QStringLiteral("Последний день диапазона (yyyy-MM-dd)."), QStringLiteral("date"));
+    const QCommandLineOption dirOption(QStringLiteral("data-dir"),
+        QStringLiteral("Каталог данных; можно указать несколько раз — отчёт по каждому."),
+        QStringLiteral("dir"));
+    const QCommandLineOption formatOption(QStringLiteral("format"),
+        QStringLiteral("Формат вывода: csv или json."), QStringLiteral("format"),
+        QStringLiteral("csv"));
+    // Разбирается в main() (Trace::configure); здесь — чтобы не считался ошибкой
+    const QCommandLineOption traceOption(QStringLiteral("trace"),
+        QStringLiteral("Записать трассировку в формате Chrome trace_event."), QStringLiteral("file"));
+    parser.addOptions({ analyzeOption, fromOption, toOption, dirOption, formatOption, traceOption });
+
+    if (!parser.parse(arguments)) {
+        err << parser.errorText() << "\n";
+        return 2;
+    }
+    if (parser.isSet(QStringLiteral("help"))) {
+        out << parser.helpText();
+        return 0;
+    }
+
+    const QDate from = QDate::fromString(parser.value(fromOption), Qt::ISODate);
+    const QDate to = QDate::fromString(parser.value(toOption), Qt::ISODate);
+    if (!from.isValid() || !to.isValid() || from > to) {
+        err << "Нужен корректный диапазон: --from yyyy-MM-dd --to yyyy-MM-dd (from <= to)\n";
+        return 2;
+    }
+
+    const QString format = parser.value(formatOption).toLower();
+    if (format != QLatin1String("csv") && format != QLatin1String("json")) {
+        err << "Неизвестный формат: " << format << " (ожидается csv или json)\n";
+        return 2;
+    }
+
+    QList<QStringList> sources;
+    for (const QString &dir : parser.values(dirOption))
+        sources.append(QStringList{ dir });
+    if (sources.isEmpty())
+        sources.append(TagAnalyzer::defaultDataDirs());
+
+    const QVector<Report> reports = analyze(sources, from, to);
+    if (format == QLatin1String("json"))
+        writeJson(out, reports, from, to);
+    else
+        writeCsv(out, reports);
+    return 0;
+}
+
+QVector<AnalysisCli::Report> AnalysisCli::analyze(const QList<QStringList> &sources,
+                                                  const QDate &from, const QDate &to)
+{
+    const auto makeReport = [](const QStringList &dirs, const QMap<QString, int> &minutes) {
+        Report report;
+        report.source = dirs.join(QLatin1Char(';'));
+        report.minutes = minutes;
+        for (auto it = minutes.constBegin(); it != minutes.constEnd(); ++it)
+            report.totalMinutes += it.value();
+        return report;
+    };
+
+    // Один источник — параллельно по дням
+    if (sources.size() == 1) {
+        const TagAnalyzer analyzer(sources.first());
+        return { makeReport(sources.first(), analyzer.aggregateConcurrent(from, to).result()) };
+    }
+
+    // Несколько — параллельно по каталогам, внутри каталога последовательно
+    const std::function<Report(const QStringList &)> analyzeSource =
+        [from, to, makeReport](const QStringList &dirs) {
+            return makeReport(dirs, TagAnalyzer(dirs).aggregate(from, to));
+        };
+    const QList<Report> reports = QtConcurrent::blockingMapped<QList<Report>>(sources, analyzeSource);
+    return QVector<Report>(reports.begin(), reports.end());
+}
+
+void AnalysisCli::writeCsv(QTextStream &out, const QVector<Report> &reports)
+{
+    out << "data_dir,tag,minutes,percent\n";
+    for (const Report &report : reports) {
+        for (auto it = report.minutes.constBegin(); it != report.minutes.constEnd(); ++it) {
+            out << csvField(report.source) << ',' << csvField(it.key()) << ','
+                << it.value() << ','
+                << QString::number(percentOf(it.value(), report.totalMinutes), 'f', 2) << "\n";
+        }
+    }
+    out.flush();
+}
+
+void AnalysisCli::writeJson(QTextStream &out, const QVector<Report> &reports,
+                            const QDate &from, const QDate &to)
+{
+    QJsonArray reportArray;
+    for (const Report &report : reports) {
+        QJsonArray tags;
+        for (auto it = report.minutes.constBegin(); it != report.minutes.constEnd(); ++it) {
+            QJsonObject tag;
+            tag["tag"] = it.key();
+            tag["minutes"] = it.value();
+            tag["percent"] = percentOf(it.value(), report.totalMinutes);
+            tags.append(tag);
+        }
+
+        QJsonObject obj;
+        obj["dataDir"] = report.source;
+        obj["totalMinutes"] = report.totalMinutes;
+        obj["tags"] = tags;
+        reportArray.append(obj);
+    }
+
+    QJsonObject root;
+    root["from"] = from.toString(Qt::ISODate);
+    root["to"] = to.toString(Qt::ISODate);
+    root["reports"] = reportArray;
+    out << QJsonDocument(root).toJson(QJsonDocument::Indented);
+    out.flush();
+}
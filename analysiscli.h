@@ -0,0 +1,42 @@
+#ifndef ANALYSISCLI_H
+#define ANALYSISCLI_H
+
+#include <QDate>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+
+// Отчёт по тегам из командной строки, без виджетов:
+//
+//   time-tracker --analyze --from 2025-01-01 --to 2025-12-31
+//                [--data-dir DIR ...] [--format csv|json]
+//
+// Каждый --data-dir — отдельный отчёт (например, данные одного человека);
+// каталоги считаются параллельно. Без --data-dir — те же каталоги, что
+// у диалога анализа (TagAnalyzer::defaultDataDirs), одним отчётом.
+class AnalysisCli
+{
+public:
+    struct Report {
+        QString source;             // каталог (или список каталогов через ';')
+        QMap<QString, int> minutes; // минуты по тегам
+        int totalMinutes = 0;
+    };
+
+    // Есть ли в аргументах --analyze (проверяется до создания QApplication)
+    static bool isRequested(int argc, char *argv[]);
+
+    // Разбор аргументов, подсчёт и вывод в stdout; возвращает код выхода
+    static int run(const QStringList &arguments);
+
+    static QVector<Report> analyze(const QList<QStringList> &sources,
+                                   const QDate &from, const QDate &to);
+
+    static void writeCsv(QTextStream &out, const QVector<Report> &reports);
+    static void writeJson(QTextStream &out, const QVector<Report> &reports,
+                          const QDate &from, const QDate &to);
+};
+
+#endif // ANALYSISCLI_H
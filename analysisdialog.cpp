@@ -1,17 +1,13 @@
 #include "analysisdialog.h"
 #include "ui_analysisdialog.h"
+#include "eventquery.h"
+#include "taganalyzer.h"
+#include "trace.h"
 
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
-#include <QFile>
-#include <QDir>
-#include <QTime>
-#include <QDebug>
-#include <QStandardPaths>
-#include <QFileInfo>
 #include <QRegularExpression>
+#include <QtConcurrent>
 #include <QHeaderView>
+#include <QProgressBar>
 
 AnalysisDialog::AnalysisDialog(QWidget *parent)
     : QDialog(parent)
@@ -20,16 +16,18 @@ AnalysisDialog::AnalysisDialog(QWidget *parent)
     ui->setupUi(this);
 
     // --- Настройка таблицы: заголовки и авто-растяжение столбцов ---
-    if (ui->tableWidgetSummary->columnCount() < 2)
-        ui->tableWidgetSummary->setColumnCount(2);
+    if (ui->tableWidgetSummary->columnCount() < 7)
+        ui->tableWidgetSummary->setColumnCount(7);
     ui->tableWidgetSummary->setHorizontalHeaderLabels(
-        { tr("Тег"), tr("Доля времени (%)") });
+        { tr("Тег"), tr("Доля времени (%)"), tr("Сессий"), tr("Медиана, мин"),
+          tr("p90, мин"), tr("p99, мин"), tr("Самые длинные") });
 
-    // Первая колонка подстраивается под содержимое (теги разной длины),
-    // вторая — растягивается, чтобы заголовок и длинные фразы влезали.
+    // Числовые колонки подстраиваются под содержимое, последняя (самые
+    // длинные сессии) растягивается, чтобы заголовок и длинные фразы влезали.
     auto *hh = ui->tableWidgetSummary->horizontalHeader();
-    hh->setSectionResizeMode(0, QHeaderView::ResizeToContents);
-    hh->setSectionResizeMode(1, QHeaderView::Stretch);
+    for (int column = 0; column < 6; ++column)
+        hh->setSectionResizeMode(column, QHeaderView::ResizeToContents);
+    hh->setSectionResizeMode(6, QHeaderView::Stretch);
 
     // Высота строк под содержание (на случай переноса строк).
     auto *vh = ui->tableWidgetSummary->verticalHeader();
@@ -39,6 +37,16 @@ AnalysisDialog::AnalysisDialog(QWidget *parent)
     ui->tableWidgetSummary->setTextElideMode(Qt::ElideNone);
     ui->tableWidgetSummary->setWordWrap(true);
 
+    // Сводная таблица: группировки в порядке EventQuery::GroupBy
+    for (EventQuery::GroupBy groupBy : { EventQuery::GroupBy::Tag, EventQuery::GroupBy::Weekday,
+                                         EventQuery::GroupBy::Hour, EventQuery::GroupBy::Month,
+                                         EventQuery::GroupBy::Title })
+        ui->comboBoxGroupBy->addItem(EventQuery::groupByName(groupBy), int(groupBy));
+    ui->tableWidgetPivot->setColumnCount(6);
+    ui->tableWidgetPivot->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    ui->tableWidgetPivot->horizontalHeader()->setStretchLastSection(true);
+    ui->tableWidgetPivot->verticalHeader()->hide();
+
     // Установка текущих дат
     ui->dateEditSingle->setDate(QDate::currentDate());
     ui->dateEditFrom->setDate(QDate::currentDate().addDays(-7));
@@ -46,107 +54,179 @@ AnalysisDialog::AnalysisDialog(QWidget *parent)
 
     connect(ui->pushButtonAnalyze, &QPushButton::clicked,
             this, &AnalysisDialog::onAnalyzeClicked);
+    connect(ui->pushButtonCancel, &QPushButton::clicked,
+            this, &AnalysisDialog::onCancelClicked);
+
+    // Прогресс и результат фоновой агрегации
+    connect(&m_watcher, &QFutureWatcher<TagStatisticsMap>::progressRangeChanged,
+            ui->progressBarAnalyze, &QProgressBar::setRange);
+    connect(&m_watcher, &QFutureWatcher<TagStatisticsMap>::progressValueChanged,
+            ui->progressBarAnalyze, &QProgressBar::setValue);
+    connect(&m_watcher, &QFutureWatcher<TagStatisticsMap>::finished,
+            this, &AnalysisDialog::onAnalysisFinished);
+    connect(&m_titlesWatcher, &QFutureWatcher<QMap<QString, QVector<Session>>>::finished,
+            this, &AnalysisDialog::onTitlesResolved);
+
+    connect(ui->pushButtonPivot, &QPushButton::clicked, this, &AnalysisDialog::onPivotClicked);
+    connect(&m_pivotWatcher, &QFutureWatcher<EventQuery::Partial>::finished,
+            this, &AnalysisDialog::onPivotFinished);
 }
 
 AnalysisDialog::~AnalysisDialog()
 {
+    // Задача не ссылается на диалог, но дождёмся её, чтобы кэш успел сохраниться
+    m_watcher.cancel();
+    m_pivotWatcher.cancel();
+    m_watcher.waitForFinished();
+    m_titlesWatcher.waitForFinished();
+    m_pivotWatcher.waitForFinished();
     delete ui;
 }
 
-void AnalysisDialog::onAnalyzeClicked()
+void AnalysisDialog::selectedRange(QDate *from, QDate *to) const
 {
-    QDate from, to;
     if (ui->radioButtonSingleDate->isChecked()) {
-        from = to = ui->dateEditSingle->date();
+        *from = *to = ui->dateEditSingle->date();
     } else {
-        from = ui->dateEditFrom->date();
-        to   = ui->dateEditTo->date();
-        if (from > to) std::swap(from, to);
+        *from = ui->dateEditFrom->date();
+        *to   = ui->dateEditTo->date();
+        if (*from > *to) std::swap(*from, *to);
     }
-
-    const QMap<QString, int> durations = loadDataByTags(from, to);
-
-    int totalMinutes = 0;
-    for (int v : durations.values())
-        totalMinutes += v;
-
-    displaySummaryTable(durations, totalMinutes);
 }
 
-QMap<QString, int> AnalysisDialog::loadDataByTags(const QDate &from, const QDate &to)
+void AnalysisDialog::onAnalyzeClicked()
 {
-    QMap<QString, int> tagDurations;
-
-    // Базовые каталоги: 1) системный AppDataLocation (как при сохранении), 2) относительный ./data (совместимость)
-    const QString appDataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-    const QString fallbackDir = QDir::current().filePath(QStringLiteral("data"));
-
-    auto filePathForDate = [&](const QDate& d) -> QString {
-        const QString baseName  = d.toString("yyyy-MM-dd") + ".json";
-        const QString primary   = QDir(appDataDir).filePath(baseName);
-        if (QFileInfo::exists(primary))
-            return primary;
-        const QString secondary = QDir(fallbackDir).filePath(baseName);
-        return secondary; // может и не существовать — проверим при открытии
-    };
-
-    QDate date = from;
-    while (date <= to) {
-        const QString fileName = filePathForDate(date);
-        QFile file(fileName);
-        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            date = date.addDays(1);
-            continue;
-        }
-
-        QJsonParseError err{};
-        const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &err);
-        file.close();
-        if (err.error != QJsonParseError::NoError) {
-            date = date.addDays(1);
-            continue;
-        }
+    QDate from, to;
+    selectedRange(&from, &to);
+    loadDataByTags(from, to);
+}
 
-        // Поддерживаем два формата: массив верхнего уровня ИЛИ объект с массивом "events"
-        QJsonArray eventsArray;
-        if (doc.isArray()) {
-            eventsArray = doc.array();
-        } else if (doc.isObject()) {
-            eventsArray = doc.object().value(QStringLiteral("events")).toArray();
-        } else {
-            date = date.addDays(1);
-            continue;
-        }
+void AnalysisDialog::onCancelClicked()
+{
+    // Отмена относится к анализу, только если он сейчас идёт: иначе флаг
+    // остался бы до следующего запуска и скрыл бы его результат
+    if (m_watcher.isRunning() || m_titlesWatcher.isRunning())
+        m_analysisCanceled = true;
+    m_watcher.cancel();
+    m_pivotWatcher.cancel();
+}
 
-        for (const QJsonValue &val : eventsArray) {
-            if (!val.isObject())
-                continue;
+void AnalysisDialog::onPivotClicked()
+{
+    EventQuery::Filter filter;
+    selectedRange(&filter.from, &filter.to);
+    const QStringList tags = ui->lineEditPivotTags->text().split(',');
+    for (const QString &tag : tags) {
+        if (!tag.trimmed().isEmpty())
+            filter.tags.insert(TagAnalyzer::tagLabel(tag));
+    }
+    filter.minMinutes = ui->spinBoxMinMinutes->value();
+    filter.maxMinutes = qMax(filter.minMinutes, ui->spinBoxMaxMinutes->value());
 
-            const QJsonObject obj = val.toObject();
+    m_pivotGroupBy = EventQuery::GroupBy(ui->comboBoxGroupBy->currentData().toInt());
+    ui->pushButtonPivot->setEnabled(false);
+    ui->pushButtonCancel->setEnabled(true);
+    m_pivotWatcher.setFuture(EventQuery(TagAnalyzer::defaultDataDirs()).runConcurrent(m_pivotGroupBy, filter));
+}
 
-            const QString rawTag = obj.value(QStringLiteral("tag")).toString().trimmed();
-            const QString tag = rawTag.isEmpty() ? QStringLiteral("Без тега") : rawTag;
+void AnalysisDialog::onPivotFinished()
+{
+    TRACE_SCOPE_CAT("AnalysisDialog::onPivotFinished", "ui");
+    ui->pushButtonPivot->setEnabled(true);
+    ui->pushButtonCancel->setEnabled(m_watcher.isRunning());
+    if (m_pivotWatcher.isCanceled())
+        return;
+
+    const EventQuery::Result result = EventQuery::finish(m_pivotGroupBy, m_pivotWatcher.result());
+
+    // Сортировка по щелчку на заголовке — после заполнения, иначе строки разъедутся
+    QTableWidget *table = ui->tableWidgetPivot;
+    table->setSortingEnabled(false);
+    table->clearContents();
+    table->setRowCount(result.groups.size());
+    table->setHorizontalHeaderLabels({ EventQuery::groupByName(m_pivotGroupBy), tr("Сумма, мин"),
+                                       tr("Событий"), tr("Мин."), tr("Макс."), tr("Среднее") });
+
+    // Число, а не текст — чтобы сортировка по столбцу была числовой
+    auto numberItem = [](const QVariant &value) {
+        auto *item = new QTableWidgetItem;
+        item->setData(Qt::DisplayRole, value);
+        item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        return item;
+    };
+    for (int row = 0; row < result.groups.size(); ++row) {
+        const EventQuery::Group &g = result.groups.at(row);
+        table->setItem(row, 0, new QTableWidgetItem(g.key));
+        table->setItem(row, 1, numberItem(g.sum));
+        table->setItem(row, 2, numberItem(g.count));
+        table->setItem(row, 3, numberItem(g.min));
+        table->setItem(row, 4, numberItem(g.max));
+        table->setItem(row, 5, numberItem(qRound(g.average() * 10) / 10.0));
+    }
+    table->setSortingEnabled(true);
+}
 
-            const QTime start = QTime::fromString(obj.value(QStringLiteral("start")).toString(), QStringLiteral("HH:mm"));
-            const QTime end   = QTime::fromString(obj.value(QStringLiteral("end")).toString(),   QStringLiteral("HH:mm"));
-            if (!start.isValid() || !end.isValid())
-                continue;
+void AnalysisDialog::onAnalysisFinished()
+{
+    if (m_watcher.isCanceled()) {
+        ui->pushButtonAnalyze->setEnabled(true);
+        ui->pushButtonCancel->setEnabled(m_pivotWatcher.isRunning());
+        ui->progressBarAnalyze->reset();
+        return;
+    }
 
-            int duration = start.secsTo(end) / 60;
-            if (duration < 0)
-                duration += 24 * 60; // переход через полночь
+    // Названия — только для нескольких самых длинных сессий каждого тега;
+    // их файлы читаются в пуле потоков, окно не ждёт
+    m_stats = m_watcher.result();
+    const TagAnalyzer analyzer(TagAnalyzer::defaultDataDirs());
+    const TagStatisticsMap stats = m_stats;
+    m_titlesWatcher.setFuture(QtConcurrent::run([analyzer, stats]() {
+        return analyzer.longestSessions(stats);
+    }));
+}
 
-            tagDurations[tag] += duration;
-        }
+void AnalysisDialog::onTitlesResolved()
+{
+    ui->pushButtonAnalyze->setEnabled(true);
+    ui->pushButtonCancel->setEnabled(m_pivotWatcher.isRunning());
+
+    // Отмена, пока дочитывались названия, — результат не показываем
+    const TagStatisticsMap stats = m_stats;
+    m_stats.clear();
+    if (m_analysisCanceled) {
+        ui->progressBarAnalyze->reset();
+        return;
+    }
 
-        date = date.addDays(1);
+    QMap<QString, int> durations;
+    int totalMinutes = 0;
+    for (auto it = stats.constBegin(); it != stats.constEnd(); ++it) {
+        durations.insert(it.key(), int(it.value().minutes));
+        totalMinutes += int(it.value().minutes);
     }
 
-    return tagDurations;
+    displaySummaryTable(durations, totalMinutes, stats, m_titlesWatcher.result());
+    ui->histogramWidget->setData(durations);
+}
+
+void AnalysisDialog::loadDataByTags(const QDate &from, const QDate &to)
+{
+    // Базовые каталоги: 1) системный AppDataLocation (как при сохранении), 2) относительный ./data (совместимость)
+    const TagAnalyzer analyzer(TagAnalyzer::defaultDataDirs());
+
+    // Пока идёт подсчёт, повторный запуск запрещён; отмена — кнопкой «Отмена»
+    ui->pushButtonAnalyze->setEnabled(false);
+    ui->pushButtonCancel->setEnabled(true);
+    ui->progressBarAnalyze->setValue(0);
+    m_analysisCanceled = false;
+    m_watcher.setFuture(analyzer.statisticsConcurrent(from, to));
 }
 
-void AnalysisDialog::displaySummaryTable(const QMap<QString, int> &durations, int totalMinutes)
+void AnalysisDialog::displaySummaryTable(const QMap<QString, int> &durations, int totalMinutes,
+                                         const TagStatisticsMap &stats,
+                                         const QMap<QString, QVector<Session>> &longest)
 {
+    TRACE_SCOPE_CAT("AnalysisDialog::displaySummaryTable", "ui");
     // Таблица уже сконфигурирована в конструкторе; здесь — только данные.
     ui->tableWidgetSummary->clearContents();
     ui->tableWidgetSummary->setRowCount(0);
@@ -210,11 +290,36 @@ void AnalysisDialog::displaySummaryTable(const QMap<QString, int> &durations, in
         pctItem->setToolTip(percentText);
         ui->tableWidgetSummary->setItem(row, 1, pctItem);
 
+        // Квантили длительности сессий — из эскиза (для небольших выборок точные)
+        const TagStatistics tagStats = stats.value(tag);
+        const QStringList numbers = {
+            QString::number(tagStats.sessions),
+            QString::number(tagStats.durations.quantile(0.5), 'f', 0),
+            QString::number(tagStats.durations.quantile(0.9), 'f', 0),
+            QString::number(tagStats.durations.quantile(0.99), 'f', 0)
+        };
+        for (int i = 0; i < numbers.size(); ++i) {
+            auto *item = new QTableWidgetItem(numbers.at(i));
+            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            ui->tableWidgetSummary->setItem(row, 2 + i, item);
+        }
+
+        // Самые длинные: в ячейке — три, в подсказке — все
+        QStringList lines;
+        for (const Session &s : longest.value(tag)) {
+            lines << QStringLiteral("%1 мин — %2 %3 %4")
+                         .arg(s.minutes)
+                         .arg(s.date.toString("dd.MM.yyyy"), s.start.toString("HH:mm"), s.title);
+        }
+        auto *longestItem = new QTableWidgetItem(QStringList(lines.mid(0, 3)).join("; "));
+        longestItem->setToolTip(lines.join('\n'));
+        ui->tableWidgetSummary->setItem(row, 6, longestItem);
+
         ++row;
     }
 
     // Подгоняем размеры после заполнения (на случай длинных значений)
     ui->tableWidgetSummary->resizeRowsToContents();
-    // Для первой колонки (ResizeToContents) ширина пересчитается автоматически;
-    // вторая растягивается на оставшееся место (Stretch).
+    // Колонки 0–5 (ResizeToContents) пересчитаются автоматически;
+    // последняя, «Самые длинные», растягивается на оставшееся место (Stretch).
 }
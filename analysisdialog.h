@@ -3,8 +3,11 @@
 
 #include <QDialog>
 #include <QDate>
+#include <QFutureWatcher>
 #include <QMap>
 #include <QString>
+#include "eventquery.h"
+#include "tagstatistics.h"
 
 namespace Ui {
 class AnalysisDialog;
@@ -24,6 +27,13 @@ public:
 
 private slots:
     void onAnalyzeClicked();
+    void onCancelClicked();
+    void onAnalysisFinished();
+    void onTitlesResolved();
+
+    // Сводная таблица: группировка и фильтры из строки над ней
+    void onPivotClicked();
+    void onPivotFinished();
 
 private:
     Ui::AnalysisDialog *ui;
@@ -31,11 +41,28 @@ private:
     // Флаг «пасхального режима». Управляется из MainWindow через setEasterEnabled()
     bool m_easterEnabled = false;
 
-    // Агрегация минут по тегам за диапазон дат
-    QMap<QString, int> loadDataByTags(const QDate &from, const QDate &to);
+    // Фоновый подсчёт статистики по тегам: результат приходит в onAnalysisFinished()
+    QFutureWatcher<TagStatisticsMap> m_watcher;
+    // Затем — названия самых длинных сессий (дочитываются из файлов тоже в
+    // фоне); таблица строится в onTitlesResolved() по m_stats
+    QFutureWatcher<QMap<QString, QVector<Session>>> m_titlesWatcher;
+    TagStatisticsMap m_stats;
+    bool m_analysisCanceled = false;   // дочитывание названий не отменить — только не показать
+
+    // Фоновый запрос сводной таблицы; группировка — на момент запуска
+    QFutureWatcher<EventQuery::Partial> m_pivotWatcher;
+    EventQuery::GroupBy m_pivotGroupBy = EventQuery::GroupBy::Tag;
+
+    // Выбранный период (одна дата или диапазон)
+    void selectedRange(QDate *from, QDate *to) const;
+
+    // Запуск подсчёта статистики по тегам за диапазон дат (параллельно, по дням)
+    void loadDataByTags(const QDate &from, const QDate &to);
 
     // Отрисовка таблицы сводки (внутри реализации проверяется m_easterEnabled)
-    void displaySummaryTable(const QMap<QString, int> &durations, int totalMinutes);
+    void displaySummaryTable(const QMap<QString, int> &durations, int totalMinutes,
+                             const TagStatisticsMap &stats,
+                             const QMap<QString, QVector<Session>> &longest);
 
     // (опционально) если в .cpp будет нужен отдельный блок для пасхальных сообщений —
     // их проще держать в отдельном методе, но объявлять не обязательно.
@@ -0,0 +1,501 @@
+// Бенчмарк ядра на синтетических данных (DatasetGenerator) за 1, 5 и 20 лет:
+// открытие дня и правка с сохранением (холодные и тёплые), анализ диапазона
+// всеми способами; разбор большого файла дня деревом QJsonDocument против
+// потокового EventScanner; импорт большого CSV.
+//
+//   time-tracker-bench [годы ...] [--events-per-day N] [--tags N]
+//                      [--description N] [--legacy доля] [--wrapped доля]
+//                      [--seed N] [--json файл] [--trace файл.json]
+//   time-tracker-bench --generate каталог [годы] [параметры данных]
+//
+// --json пишет результаты в машиночитаемом виде (для сравнения сборок);
+// --generate только создаёт каталог данных и выходит.
+
+#include "datasetgenerator.h"
+#include "daycache.h"
+#include "daystore.h"
+#include "eventimporter.h"
+#include "eventquery.h"
+#include "eventjson.h"
+#include "eventscanner.h"
+#include "taganalyzer.h"
+#include "trace.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThreadPool>
+#include <utility>
+
+namespace {
+
+// Дней в выборке для замеров открытия и правки (равномерно по диапазону)
+const int kSampleDays = 365;
+
+// Результаты всех сценариев — для --json
+QJsonArray g_results;
+
+void report(const QString &scenario, const QJsonObject &parameters, const QJsonObject &metrics)
+{
+    QJsonObject result = parameters;
+    result.insert(QStringLiteral("scenario"), scenario);
+    result.insert(QStringLiteral("metrics"), metrics);
+    g_results.append(result);
+}
+
+double elapsedMs(const QElapsedTimer &timer)
+{
+    return timer.nsecsElapsed() / 1e6;
+}
+
+QString ms(double value)
+{
+    return QString::number(value, 'f', 1);
+}
+
+DatasetGenerator::Options optionsForYears(DatasetGenerator::Options options, int years)
+{
+    options.to = QDate(2025, 12, 31);
+    options.from = options.to.addYears(-years).addDays(1);
+    return options;
+}
+
+QJsonObject datasetJson(const DatasetGenerator::Options &options)
+{
+    return {
+        { QStringLiteral("from"), options.from.toString(Qt::ISODate) },
+        { QStringLiteral("to"), options.to.toString(Qt::ISODate) },
+        { QStringLiteral("min_events_per_day"), options.minEventsPerDay },
+        { QStringLiteral("max_events_per_day"), options.maxEventsPerDay },
+        { QStringLiteral("tags"), options.tagCount },
+        { QStringLiteral("description_length"), options.descriptionLength },
+        { QStringLiteral("legacy_share"), options.legacyShare },
+        { QStringLiteral("wrapped_share"), options.wrappedShare },
+        { QStringLiteral("seed"), qint64(options.seed) }
+    };
+}
+
+void runScenario(QTextStream &out, const DatasetGenerator::Options &baseOptions, int years)
+{
+    QTemporaryDir tmp;
+    if (!tmp.isValid()) {
+        out << "Не удалось создать временный каталог\n";
+        return;
+    }
+
+    const DatasetGenerator::Options options = optionsForYears(baseOptions, years);
+    const DatasetGenerator generator(options);
+    const DayStore store(tmp.path());
+    const QDate from = options.from;
+    const QDate to = options.to;
+    QElapsedTimer timer;
+    QString error;
+
+    timer.start();
+    DatasetGenerator::Stats dataset;
+    if (!generator.write(tmp.path(), &dataset, &error)) {
+        out << error << "\n";
+        return;
+    }
+    const double generateMs = elapsedMs(timer);
+
+    // Выборка дней с файлами: открытие и правка — как при переходах по календарю
+    QVector<QDate> sample;
+    const int step = qMax<qint64>(1, (from.daysTo(to) + 1) / kSampleDays);
+    for (QDate d = from; d <= to && sample.size() < kSampleDays; d = d.addDays(step)) {
+        if (store.signature(d).exists())
+            sample.append(d);
+    }
+
+    // Открытие: холодное — кэш дней пуст, день читается и разбирается;
+    // тёплое — повторный переход к уже открытому дню
+    DayCache cache(sample.size() + 1, qint64(1) << 40);
+    QVector<QDate> needResave;
+    qint64 loaded = 0;
+    timer.restart();
+    for (const QDate &d : std::as_const(sample)) {
+        QVector<Event> events;
+        bool generatedIds = false;
+        store.load(d, events, &generatedIds);
+        if (generatedIds)
+            needResave.append(d);
+        loaded += events.size();
+        cache.insert(d, events, store.signature(d));
+    }
+    const double openColdMs = elapsedMs(timer);
+
+    timer.restart();
+    for (const QDate &d : std::as_const(sample))
+        cache.find(d);
+    const double openWarmMs = elapsedMs(timer);
+
+    // Правка: первая правка дня — пересохранение снимка, если у событий не
+    // было id (старый файл), и новый журнал; следующие — дозапись в журнал
+    Event edit;
+    edit.title = QStringLiteral("Правка");
+    edit.start = QTime(6, 0);
+    edit.end = QTime(6, 30);
+    edit.tag = DatasetGenerator::tagName(0);
+
+    timer.restart();
+    for (const QDate &d : std::as_const(sample)) {
+        if (needResave.contains(d))
+            store.save(d, *cache.peek(d), &error);
+        edit.id = QUuid::createUuid();
+        store.appendToJournal(d, DayStore::JournalOp::Add, edit, &error);
+    }
+    const double editColdMs = elapsedMs(timer);
+
+    timer.restart();
+    for (const QDate &d : std::as_const(sample)) {
+        edit.id = QUuid::createUuid();
+        store.appendToJournal(d, DayStore::JournalOp::Add, edit, &error);
+    }
+    const double editWarmMs = elapsedMs(timer);
+
+    TagAnalyzer analyzer({ tmp.path() });
+    analyzer.setUseRollups(false);
+    analyzer.setUseArchive(false);
+    timer.restart();
+    const QMap<QString, int> totals = analyzer.aggregate(from, to);
+    const double analyzeMs = elapsedMs(timer);
+
+    // Тот же разбор JSON, но map-reduce по дням в пуле потоков
+    timer.restart();
+    analyzer.aggregateConcurrent(from, to).waitForFinished();
+    const double parallelMs = elapsedMs(timer);
+
+    // Колоночный архив: первый проход собирает архивы месяцев, второй — только читает
+    analyzer.setUseArchive(true);
+    timer.restart();
+    analyzer.aggregate(from, to);
+    const double archiveColdMs = elapsedMs(timer);
+    timer.restart();
+    analyzer.aggregate(from, to);
+    const double archiveWarmMs = elapsedMs(timer);
+
+    // Кэш сумм по дням: холодный проход берёт дни из собранных выше архивов
+    // (без них — разбор JSON), тёплый — только stat()
+    analyzer.setUseRollups(true);
+    timer.restart();
+    analyzer.aggregate(from, to);
+    const double rollupColdMs = elapsedMs(timer);
+    timer.restart();
+    analyzer.aggregate(from, to);
+    const double rollupWarmMs = elapsedMs(timer);
+
+    // Квантили и самые длинные сессии — из того же кэша (эскизы дней сливаются)
+    timer.restart();
+    const TagStatisticsMap stats = analyzer.statisticsConcurrent(from, to).result();
+    analyzer.longestSessions(stats);
+    const double statisticsMs = elapsedMs(timer);
+
+    // Сводная таблица по колонкам архивов (архивы уже собраны проходом выше)
+    EventQuery::Filter filter;
+    filter.from = from;
+    filter.to = to;
+    timer.restart();
+    const EventQuery::Result byWeekday = EventQuery({ tmp.path() }).run(EventQuery::GroupBy::Weekday, filter);
+    const double queryMs = elapsedMs(timer);
+
+    // Минутные битовые карты: объединение, наложения, тепловая карта
+    timer.restart();
+    const TagAnalyzer::Occupancy occupancy = analyzer.occupancy(from, to);
+    const double occupancyMs = elapsedMs(timer);
+
+    const int sampled = qMax(1, sample.size());
+    out << QStringLiteral("%1 г. (%2 дн. с данными, %3 событий, %4 МБ; без id %5, {events} %6): "
+                          "генерация %7 мс\n")
+               .arg(years).arg(dataset.days).arg(dataset.events).arg(dataset.bytes / (1024 * 1024))
+               .arg(dataset.legacyDays).arg(dataset.wrappedDays).arg(ms(generateMs));
+    out << QStringLiteral("  день (выборка %1, %2 событий): open cold %3 мкс, open warm %4 мкс, "
+                          "edit cold %5 мкс, edit warm %6 мкс\n")
+               .arg(sample.size()).arg(loaded)
+               .arg(ms(openColdMs * 1000 / sampled)).arg(ms(openWarmMs * 1000 / sampled))
+               .arg(ms(editColdMs * 1000 / sampled)).arg(ms(editWarmMs * 1000 / sampled));
+    out << QStringLiteral("  диапазон: analyze %1 мс (%2 тегов), parallel %3 мс, archive cold %4 мс, "
+                          "archive warm %5 мс, rollups cold %6 мс, rollups warm %7 мс, statistics %8 мс, "
+                          "query по дням недели %9 мс (%10 событий), occupancy %11 мс "
+                          "(занято %12 мин, наложений %13 мин)\n")
+               .arg(ms(analyzeMs)).arg(totals.size()).arg(ms(parallelMs))
+               .arg(ms(archiveColdMs)).arg(ms(archiveWarmMs))
+               .arg(ms(rollupColdMs)).arg(ms(rollupWarmMs)).arg(ms(statisticsMs))
+               .arg(ms(queryMs)).arg(byWeekday.count).arg(ms(occupancyMs))
+               .arg(occupancy.busyMinutes).arg(occupancy.overlapMinutes);
+    out.flush();
+
+    QJsonObject parameters = datasetJson(options);
+    parameters.insert(QStringLiteral("years"), years);
+    parameters.insert(QStringLiteral("days"), dataset.days);
+    parameters.insert(QStringLiteral("events"), dataset.events);
+    parameters.insert(QStringLiteral("bytes"), dataset.bytes);
+    parameters.insert(QStringLiteral("sample_days"), sample.size());
+    report(QStringLiteral("dataset"), parameters, {
+        { QStringLiteral("generate_ms"), generateMs },
+        { QStringLiteral("open_cold_us_per_day"), openColdMs * 1000 / sampled },
+        { QStringLiteral("open_warm_us_per_day"), openWarmMs * 1000 / sampled },
+        { QStringLiteral("edit_cold_us_per_day"), editColdMs * 1000 / sampled },
+        { QStringLiteral("edit_warm_us_per_day"), editWarmMs * 1000 / sampled },
+        { QStringLiteral("analyze_ms"), analyzeMs },
+        { QStringLiteral("analyze_parallel_ms"), parallelMs },
+        { QStringLiteral("archive_cold_ms"), archiveColdMs },
+        { QStringLiteral("archive_warm_ms"), archiveWarmMs },
+        { QStringLiteral("rollups_cold_ms"), rollupColdMs },
+        { QStringLiteral("rollups_warm_ms"), rollupWarmMs },
+        { QStringLiteral("statistics_ms"), statisticsMs },
+        { QStringLiteral("query_weekday_ms"), queryMs },
+        { QStringLiteral("occupancy_ms"), occupancyMs }
+    });
+}
+
+// Один «день» из eventCount событий, разобранный repeats раз каждым способом
+void runParserScenario(QTextStream &out, int eventCount, int repeats)
+{
+    DatasetGenerator::Options options;
+    options.from = QDate(2000, 1, 1);
+    options.to = options.from;
+    options.minEventsPerDay = eventCount;
+    options.maxEventsPerDay = eventCount;
+    const QByteArray data = EventJson::serializeDay(DatasetGenerator(options).generateDay(options.from));
+
+    QElapsedTimer timer;
+    QVector<Event> parsed;
+
+    timer.start();
+    for (int i = 0; i < repeats; ++i)
+        EventJson::parseDayDocument(data, parsed);
+    const double domMs = elapsedMs(timer);
+
+    timer.restart();
+    for (int i = 0; i < repeats; ++i)
+        EventScanner::parseDay(data, parsed);
+    const double scanAllMs = elapsedMs(timer);
+
+    timer.restart();
+    for (int i = 0; i < repeats; ++i)
+        EventScanner::parseDay(data, parsed, EventScanner::TimeAndTag);
+    const double scanTagsMs = elapsedMs(timer);
+
+    out << QStringLiteral("Разбор файла дня (%1 событий, %2 КБ, x%3): QJsonDocument %4 мс, "
+                          "scanner (все поля) %5 мс, scanner (тег и время) %6 мс\n")
+               .arg(eventCount).arg(data.size() / 1024).arg(repeats)
+               .arg(ms(domMs)).arg(ms(scanAllMs)).arg(ms(scanTagsMs));
+    out.flush();
+
+    report(QStringLiteral("parser"), {
+        { QStringLiteral("events"), eventCount },
+        { QStringLiteral("bytes"), data.size() },
+        { QStringLiteral("repeats"), repeats }
+    }, {
+        { QStringLiteral("document_ms"), domMs },
+        { QStringLiteral("scanner_all_ms"), scanAllMs },
+        { QStringLiteral("scanner_time_tag_ms"), scanTagsMs }
+    });
+}
+
+// CSV из eventCount событий подряд по дням: импорт в пустой каталог
+// и повторный импорт того же файла (все события — дубликаты)
+void runImportScenario(QTextStream &out, int eventCount)
+{
+    QTemporaryDir tmp;
+    if (!tmp.isValid()) {
+        out << "Не удалось создать временный каталог\n";
+        return;
+    }
+
+    const QString csvPath = tmp.filePath("import.csv");
+    QFile csv(csvPath);
+    if (!csv.open(QIODevice::WriteOnly)) {
+        out << "Не удалось создать " << csvPath << "\n";
+        return;
+    }
+    csv.write("date,start,end,title,tag,description\n");
+    const DatasetGenerator generator;
+    int written = 0;
+    for (QDate d(2000, 1, 1); written < eventCount; d = d.addDays(1)) {
+        const QByteArray date = d.toString("yyyy-MM-dd").toUtf8();
+        const QVector<Event> events = generator.generateDay(d);
+        for (const Event &e : events) {
+            if (written++ >= eventCount)
+                break;
+            csv.write(date + ',' + e.start.toString("HH:mm").toUtf8() + ','
+                      + e.end.toString("HH:mm").toUtf8() + ",\"" + e.title.toUtf8() + "\","
+                      + e.tag.toUtf8() + ",\"" + e.description.toUtf8() + "\"\n");
+        }
+    }
+    const qint64 csvBytes = csv.size();
+    csv.close();
+
+    const DayStore store(tmp.filePath("data"));
+    QElapsedTimer timer;
+    EventImporter::Stats first, second;
+    QString error;
+
+    timer.start();
+    if (!EventImporter(store).importFile(csvPath, EventImporter::Format::Csv, &first, &error))
+        out << error << "\n";
+    const double firstMs = elapsedMs(timer);
+
+    timer.restart();
+    if (!EventImporter(store).importFile(csvPath, EventImporter::Format::Csv, &second, &error))
+        out << error << "\n";
+    const double secondMs = elapsedMs(timer);
+
+    out << QStringLiteral("Импорт CSV (%1 событий, %2 МБ): %3 мс, %4 дней; "
+                          "повторно %5 мс, дубликатов %6\n")
+               .arg(first.read).arg(csvBytes / (1024 * 1024)).arg(ms(firstMs))
+               .arg(first.daysWritten).arg(ms(secondMs)).arg(second.duplicates);
+    out.flush();
+
+    report(QStringLiteral("import"), {
+        { QStringLiteral("events"), first.read },
+        { QStringLiteral("bytes"), csvBytes },
+        { QStringLiteral("days"), first.daysWritten }
+    }, {
+        { QStringLiteral("import_ms"), firstMs },
+        { QStringLiteral("reimport_ms"), secondMs },
+        { QStringLiteral("reimport_duplicates"), second.duplicates }
+    });
+}
+
+bool writeJson(const QString &path, const DatasetGenerator::Options &options, QString *errorString)
+{
+    const QJsonObject root {
+        { QStringLiteral("version"), 1 },
+        { QStringLiteral("qt"), QString::fromLatin1(qVersion()) },
+        { QStringLiteral("cpu"), QSysInfo::currentCpuArchitecture() },
+        { QStringLiteral("os"), QSysInfo::prettyProductName() },
+        { QStringLiteral("threads"), QThreadPool::globalInstance()->maxThreadCount() },
+        { QStringLiteral("dataset"), datasetJson(options) },
+        { QStringLiteral("results"), g_results }
+    };
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorString)
+            *errorString = "Не удалось открыть файл результатов: " + path + "\n" + file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    if (!file.commit()) {
+        if (errorString)
+            *errorString = "Не удалось записать файл результатов: " + path + "\n" + file.errorString();
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Trace::configure(argc, argv);
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Бенчмарк ядра на синтетических данных"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("годы"), QStringLiteral("Объёмы данных в годах (по умолчанию 1 5 20)."));
+    const QCommandLineOption eventsOption(QStringLiteral("events-per-day"),
+        QStringLiteral("Событий в дне: N или MIN-MAX (по умолчанию 3-10)."), QStringLiteral("n"));
+    const QCommandLineOption tagsOption(QStringLiteral("tags"),
+        QStringLiteral("Различных тегов (по умолчанию 5)."), QStringLiteral("n"));
+    const QCommandLineOption descriptionOption(QStringLiteral("description"),
+        QStringLiteral("Средняя длина описания, символов (по умолчанию 40)."), QStringLiteral("n"));
+    const QCommandLineOption legacyOption(QStringLiteral("legacy"),
+        QStringLiteral("Доля дней без id у событий, 0..1."), QStringLiteral("share"));
+    const QCommandLineOption wrappedOption(QStringLiteral("wrapped"),
+        QStringLiteral("Доля дней в виде {\"events\": [...]}, 0..1."), QStringLiteral("share"));
+    const QCommandLineOption emptyOption(QStringLiteral("empty"),
+        QStringLiteral("Доля дней без данных, 0..1."), QStringLiteral("share"));
+    const QCommandLineOption seedOption(QStringLiteral("seed"),
+        QStringLiteral("Зерно генератора (по умолчанию 1)."), QStringLiteral("n"));
+    const QCommandLineOption jsonOption(QStringLiteral("json"),
+        QStringLiteral("Записать результаты в JSON."), QStringLiteral("file"));
+    const QCommandLineOption generateOption(QStringLiteral("generate"),
+        QStringLiteral("Только создать каталог данных и выйти."), QStringLiteral("dir"));
+    const QCommandLineOption traceOption(QStringLiteral("trace"),
+        QStringLiteral("Записать трассировку (chrome://tracing)."), QStringLiteral("file"));
+    const QCommandLineOption importOption(QStringLiteral("import"),
+        QStringLiteral("Добавить сценарий импорта CSV из N событий (например, 1000000)."),
+        QStringLiteral("n"));
+    parser.addOptions({ eventsOption, tagsOption, descriptionOption, legacyOption, wrappedOption,
+                        emptyOption, seedOption, jsonOption, generateOption, traceOption,
+                        importOption });
+    parser.process(app);
+
+    DatasetGenerator::Options options;
+    if (parser.isSet(eventsOption)) {
+        const QStringList range = parser.value(eventsOption).split('-');
+        options.minEventsPerDay = range.first().toInt();
+        options.maxEventsPerDay = range.last().toInt();
+    }
+    if (parser.isSet(tagsOption))
+        options.tagCount = parser.value(tagsOption).toInt();
+    if (parser.isSet(descriptionOption))
+        options.descriptionLength = parser.value(descriptionOption).toInt();
+    if (parser.isSet(legacyOption))
+        options.legacyShare = parser.value(legacyOption).toDouble();
+    if (parser.isSet(wrappedOption))
+        options.wrappedShare = parser.value(wrappedOption).toDouble();
+    if (parser.isSet(emptyOption))
+        options.emptyDayShare = parser.value(emptyOption).toDouble();
+    if (parser.isSet(seedOption))
+        options.seed = parser.value(seedOption).toUInt();
+
+    QList<int> scenarios;
+    const QStringList args = parser.positionalArguments();
+    for (const QString &arg : args) {
+        bool ok = false;
+        const int years = arg.toInt(&ok);
+        if (ok && years > 0)
+            scenarios << years;
+    }
+
+    int code = 0;
+    if (parser.isSet(generateOption)) {
+        const DatasetGenerator generator(optionsForYears(options, scenarios.value(0, 1)));
+        DatasetGenerator::Stats stats;
+        QString error;
+        if (generator.write(parser.value(generateOption), &stats, &error)) {
+            out << QStringLiteral("%1 дн., %2 событий, %3 МБ (без id %4, {events} %5)\n")
+                       .arg(stats.days).arg(stats.events).arg(stats.bytes / (1024 * 1024))
+                       .arg(stats.legacyDays).arg(stats.wrappedDays);
+        } else {
+            out << error << "\n";
+            code = 1;
+        }
+    } else {
+        if (scenarios.isEmpty())
+            scenarios = { 1, 5, 20 };
+        for (int years : scenarios)
+            runScenario(out, options, years);
+        runParserScenario(out, 100000, 5);
+        // Импорт большого файла идёт долго — только по запросу
+        if (parser.isSet(importOption)) {
+            const int importEvents = parser.value(importOption).toInt();
+            if (importEvents > 0)
+                runImportScenario(out, importEvents);
+        }
+
+        QString jsonError;
+        if (parser.isSet(jsonOption) && !writeJson(parser.value(jsonOption), options, &jsonError)) {
+            out << jsonError << "\n";
+            code = 1;
+        }
+    }
+
+    QString traceError;
+    if (!Trace::finish(&traceError))
+        out << traceError << "\n";
+    return code;
+}
@@ -0,0 +1,125 @@
+#include "datadirwatcher.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSet>
+#include <QtConcurrent>
+#include <algorithm>
+
+namespace {
+
+// Серия событий от одной записи (QSaveFile: временный файл + переименование)
+// схлопывается в один листинг
+const int kDebounceMs = 200;
+
+} // namespace
+
+DataDirWatcher::DataDirWatcher(const QString &dataDir, QObject *parent)
+    : QObject(parent)
+    , m_dataDir(dataDir)
+{
+    m_debounce.setSingleShot(true);
+    m_debounce.setInterval(kDebounceMs);
+    connect(&m_debounce, &QTimer::timeout, this, &DataDirWatcher::scan);
+    connect(&m_listing, &QFutureWatcher<QHash<QString, FileState>>::finished,
+            this, &DataDirWatcher::onListed);
+
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, &m_debounce,
+            static_cast<void (QTimer::*)()>(&QTimer::start));
+    connect(&m_watcher, &QFileSystemWatcher::fileChanged, &m_debounce,
+            static_cast<void (QTimer::*)()>(&QTimer::start));
+
+    QDir().mkpath(m_dataDir);
+    m_watcher.addPath(m_dataDir);
+    scan();     // точка отсчёта — тоже в фоне
+}
+
+void DataDirWatcher::watchDay(const QDate &date)
+{
+    m_watchedDay = date;
+    rewatchDayFiles();
+}
+
+void DataDirWatcher::rewatchDayFiles()
+{
+    const QStringList watched = m_watcher.files();
+    if (!watched.isEmpty())
+        m_watcher.removePaths(watched);
+    if (!m_watchedDay.isValid())
+        return;
+
+    // Несуществующий файл отследить нельзя — его появление увидит слежение за каталогом
+    const QString base = m_dataDir + "/" + m_watchedDay.toString("yyyy-MM-dd");
+    for (const QString &path : { base + ".json", base + ".journal" }) {
+        if (QFileInfo::exists(path))
+            m_watcher.addPath(path);
+    }
+}
+
+QHash<QString, DataDirWatcher::FileState> DataDirWatcher::listFiles(const QString &dataDir)
+{
+    QHash<QString, FileState> files;
+    const QFileInfoList entries = QDir(dataDir).entryInfoList(
+        { QStringLiteral("*.json"), QStringLiteral("*.journal") }, QDir::Files);
+    files.reserve(entries.size());
+    for (const QFileInfo &info : entries) {
+        FileState state;
+        state.mtime = info.lastModified().toMSecsSinceEpoch();
+        state.size = info.size();
+        files.insert(info.fileName(), state);
+    }
+    return files;
+}
+
+void DataDirWatcher::scan()
+{
+    if (m_listing.isRunning()) {
+        m_rescan = true;    // изменения во время листинга — ещё один проход после
+        return;
+    }
+    m_rescan = false;
+    m_listing.setFuture(QtConcurrent::run(&DataDirWatcher::listFiles, m_dataDir));
+}
+
+void DataDirWatcher::onListed()
+{
+    const QHash<QString, FileState> files = m_listing.result();
+    if (m_rescan)
+        scan();
+
+    // Первый листинг — только точка отсчёта
+    if (!m_listed) {
+        m_listed = true;
+        m_files = files;
+        rewatchDayFiles();
+        return;
+    }
+
+    QSet<QDate> changed;
+    for (auto it = files.constBegin(); it != files.constEnd(); ++it) {
+        const auto old = m_files.constFind(it.key());
+        if (old == m_files.constEnd() || old.value() != it.value())
+            changed.insert(dateOfFile(it.key()));
+    }
+    for (auto it = m_files.constBegin(); it != m_files.constEnd(); ++it) {
+        if (!files.contains(it.key()))
+            changed.insert(dateOfFile(it.key()));
+    }
+    changed.remove(QDate());
+    m_files = files;
+
+    // Атомарная замена файла снимает с него слежение — ставим заново
+    rewatchDayFiles();
+
+    if (changed.isEmpty())
+        return;
+    QList<QDate> dates = changed.values();
+    std::sort(dates.begin(), dates.end());
+    emit daysChanged(dates);
+}
+
+QDate DataDirWatcher::dateOfFile(const QString &fileName)
+{
+    return QDate::fromString(fileName.section('.', 0, 0), QStringLiteral("yyyy-MM-dd"));
+}
@@ -0,0 +1,64 @@
+#ifndef DATADIRWATCHER_H
+#define DATADIRWATCHER_H
+
+#include <QDate>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+// Слежение за каталогом данных: чужие правки (другой экземпляр программы,
+// синхронизация, ручное редактирование) превращаются в список изменившихся
+// дней. Никаких периодических проходов — только по событиям файловой системы:
+// после серии событий (debounce) листинг каталога сравнивается с прошлым
+// по времени изменения и размеру файлов дней (*.json, *.journal).
+// Листинг (entryInfoList и stat каждого файла) идёт в пуле потоков, окно
+// только сравнивает готовый результат с прошлым.
+// Файлы открытого дня дополнительно отслеживаются поштучно — правка на месте
+// (дозапись журнала) не всегда видна как изменение каталога.
+class DataDirWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DataDirWatcher(const QString &dataDir, QObject *parent = nullptr);
+
+    // День, который сейчас открыт
+    void watchDay(const QDate &date);
+
+signals:
+    // Даты по возрастанию; свои записи сюда тоже попадают — отличать их
+    // (по подписи дня) должен получатель
+    void daysChanged(const QList<QDate> &dates);
+
+private:
+    struct FileState {
+        qint64 mtime = 0;
+        qint64 size = 0;
+        bool operator==(const FileState &o) const { return mtime == o.mtime && size == o.size; }
+        bool operator!=(const FileState &o) const { return !(*this == o); }
+    };
+
+    QString m_dataDir;
+    QFileSystemWatcher m_watcher;
+    QTimer m_debounce;
+    QHash<QString, FileState> m_files;    // имя файла → состояние на прошлом листинге
+    QDate m_watchedDay;
+
+    // Фоновый листинг; пока он идёт, новые события только ставят повтор
+    QFutureWatcher<QHash<QString, FileState>> m_listing;
+    bool m_listed = false;      // первый листинг (точка отсчёта) получен
+    bool m_rescan = false;
+
+    static QHash<QString, FileState> listFiles(const QString &dataDir);
+    void scan();
+    void onListed();
+    void rewatchDayFiles();
+
+    static QDate dateOfFile(const QString &fileName);
+};
+
+#endif // DATADIRWATCHER_H
@@ -0,0 +1,221 @@
+#include "datasetgenerator.h"
+#include "eventjson.h"
+#include "trace.h"
+
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QSaveFile>
+#include <QtConcurrent>
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+const QStringList kTagNames = {
+    QStringLiteral("Работа"), QStringLiteral("Учёба"), QStringLiteral("Спорт"),
+    QStringLiteral("Отдых"), QStringLiteral("Чтение"), QStringLiteral("Дорога"),
+    QStringLiteral("Дом"), QStringLiteral("Встречи")
+};
+
+const QStringList kTitles = {
+    QStringLiteral("Созвон"), QStringLiteral("Планирование"), QStringLiteral("Ревью"),
+    QStringLiteral("Тренировка"), QStringLiteral("Лекция"), QStringLiteral("Обед"),
+    QStringLiteral("Прогулка"), QStringLiteral("Отчёт"), QStringLiteral("Покупки"),
+    QStringLiteral("Книга")
+};
+
+const QStringList kWords = {
+    QStringLiteral("обсудили"), QStringLiteral("задачи"), QStringLiteral("недели"),
+    QStringLiteral("проект"), QStringLiteral("сроки"), QStringLiteral("план"),
+    QStringLiteral("итоги"), QStringLiteral("замечания"), QStringLiteral("вопросы"),
+    QStringLiteral("следующий"), QStringLiteral("шаг"), QStringLiteral("материалы")
+};
+
+// Потоки случайных чисел одного дня: разные решения не зависят друг от друга,
+// поэтому, например, доля старых файлов не меняет сами события
+enum Stream : quint32 { EventsStream = 1, PresenceStream = 2, ShapeStream = 3 };
+
+struct DayResult {
+    bool written = false;
+    bool ok = true;
+    int events = 0;
+    qint64 bytes = 0;
+    DatasetGenerator::FileShape shape;
+    QString error;
+};
+
+} // namespace
+
+DatasetGenerator::DatasetGenerator(const Options &options)
+    : m_options(options)
+{
+    m_options.tagCount = qMax(1, m_options.tagCount);
+    m_options.minEventsPerDay = qMax(0, m_options.minEventsPerDay);
+    m_options.maxEventsPerDay = qMax(m_options.minEventsPerDay, m_options.maxEventsPerDay);
+    m_options.descriptionLength = qMax(0, m_options.descriptionLength);
+
+    // Тег k встречается с весом 1/(k+1): немного частых тегов и длинный хвост
+    double sum = 0;
+    for (int k = 0; k < m_options.tagCount; ++k) {
+        sum += 1.0 / (k + 1);
+        m_tagCdf.append(sum);
+    }
+    for (double &w : m_tagCdf)
+        w /= sum;
+    m_tagCdf.last() = 1.0;
+}
+
+QString DatasetGenerator::tagName(int index)
+{
+    return index < kTagNames.size() ? kTagNames.at(index)
+                                    : QStringLiteral("Тег %1").arg(index + 1);
+}
+
+quint32 DatasetGenerator::daySeed(const QDate &date, quint32 stream) const
+{
+    // Перемешивание (как в splitmix): соседние дни не дают похожих зёрен
+    quint64 x = (quint64(m_options.seed) << 32) ^ quint64(date.toJulianDay()) ^ (quint64(stream) << 56);
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return quint32(x) ^ quint32(x >> 32);
+}
+
+QVector<Event> DatasetGenerator::generateDay(const QDate &date) const
+{
+    QVector<Event> events;
+    QRandomGenerator presence(daySeed(date, PresenceStream));
+    if (presence.generateDouble() < m_options.emptyDayShare)
+        return events;
+
+    QRandomGenerator rng(daySeed(date, EventsStream));
+    const int count = m_options.minEventsPerDay
+                      + rng.bounded(m_options.maxEventsPerDay - m_options.minEventsPerDay + 1);
+    events.reserve(count);
+
+    // События идут подряд с 7:00; длина — около доли дня на событие
+    const int slot = count > 0 ? qMax(2, 16 * 60 / count) : 60;
+    int minute = 7 * 60;
+    for (int i = 0; i < count; ++i) {
+        const int length = 5 + rng.bounded(qMax(1, slot * 3 / 2));
+
+        Event e;
+        // id из того же генератора: воспроизводимы, как и всё остальное
+        const quint32 a = rng.generate(), b = rng.generate(), c = rng.generate(), d = rng.generate();
+        e.id = QUuid(a, quint16(b), quint16((b >> 16 & 0x0fff) | 0x4000),
+                     uchar((c & 0x3f) | 0x80), uchar(c >> 8), uchar(c >> 16), uchar(c >> 24),
+                     uchar(d), uchar(d >> 8), uchar(d >> 16), uchar(d >> 24));
+        e.title = kTitles.at(rng.bounded(kTitles.size()));
+        e.start = QTime(0, 0).addSecs((minute % (24 * 60)) * 60);
+        e.end = QTime(0, 0).addSecs(((minute + length) % (24 * 60)) * 60);
+
+        if (rng.generateDouble() >= m_options.untaggedShare) {
+            const double u = rng.generateDouble();
+            const int tag = int(std::lower_bound(m_tagCdf.cbegin(), m_tagCdf.cend(), u) - m_tagCdf.cbegin());
+            e.tag = tagName(qMin(tag, m_options.tagCount - 1));
+        }
+
+        const int target = m_options.descriptionLength > 0
+                               ? rng.bounded(2 * m_options.descriptionLength + 1) : 0;
+        while (e.description.size() < target) {
+            if (!e.description.isEmpty())
+                e.description += ' ';
+            e.description += kWords.at(rng.bounded(kWords.size()));
+        }
+        e.description.truncate(target);
+
+        events.append(e);
+        minute += length + rng.bounded(qMax(1, slot / 2));
+    }
+    return events;
+}
+
+DatasetGenerator::FileShape DatasetGenerator::shapeForDate(const QDate &date) const
+{
+    QRandomGenerator rng(daySeed(date, ShapeStream));
+    FileShape shape;
+    shape.ids = rng.generateDouble() >= m_options.legacyShare;
+    shape.wrapped = rng.generateDouble() < m_options.wrappedShare;
+    return shape;
+}
+
+QByteArray DatasetGenerator::serialize(const QVector<Event> &events, const FileShape &shape)
+{
+    if (shape.ids && !shape.wrapped)
+        return EventJson::serializeDay(events);
+
+    QJsonArray arr;
+    for (const Event &e : events) {
+        QJsonObject obj = EventJson::toJson(e);
+        if (!shape.ids)
+            obj.remove(QStringLiteral("id"));
+        arr.append(obj);
+    }
+    const QJsonDocument doc = shape.wrapped
+                                  ? QJsonDocument(QJsonObject { { QStringLiteral("events"), arr } })
+                                  : QJsonDocument(arr);
+    return doc.toJson(QJsonDocument::Indented);
+}
+
+bool DatasetGenerator::write(const QString &dataDir, Stats *stats, QString *errorString) const
+{
+    TRACE_SCOPE("DatasetGenerator::write");
+    if (!QDir().mkpath(dataDir)) {
+        if (errorString)
+            *errorString = "Не удалось создать каталог: " + dataDir;
+        return false;
+    }
+
+    QVector<QDate> dates;
+    for (QDate d = m_options.from; d.isValid() && d <= m_options.to; d = d.addDays(1))
+        dates.append(d);
+
+    const QDir dir(dataDir);
+    std::function<DayResult(const QDate &)> writeDay = [this, dir](const QDate &date) {
+        DayResult result;
+        const QVector<Event> events = generateDay(date);
+        if (events.isEmpty())
+            return result;
+
+        result.shape = shapeForDate(date);
+        const QByteArray data = serialize(events, result.shape);
+        QSaveFile file(dir.filePath(date.toString("yyyy-MM-dd") + ".json"));
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+            result.ok = false;
+            result.error = "Не удалось записать файл: " + file.fileName() + "\n" + file.errorString();
+            return result;
+        }
+        Trace::count(Trace::FilesWritten);
+        result.written = true;
+        result.events = events.size();
+        result.bytes = data.size();
+        return result;
+    };
+    const QVector<DayResult> results = QtConcurrent::blockingMapped<QVector<DayResult>>(dates, writeDay);
+
+    Stats total;
+    for (const DayResult &r : results) {
+        if (!r.ok) {
+            if (errorString)
+                *errorString = r.error;
+            return false;
+        }
+        if (!r.written)
+            continue;
+        ++total.days;
+        total.events += r.events;
+        total.bytes += r.bytes;
+        if (!r.shape.ids)
+            ++total.legacyDays;
+        if (r.shape.wrapped)
+            ++total.wrappedDays;
+    }
+    if (stats)
+        *stats = total;
+    return true;
+}
@@ -0,0 +1,70 @@
+#ifndef DATASETGENERATOR_H
+#define DATASETGENERATOR_H
+
+#include <QByteArray>
+#include <QDate>
+#include <QString>
+#include <QVector>
+#include "event.h"
+
+// Синтетический каталог данных для бенчмарков: файлы дней в том виде, в
+// каком их пишет приложение (EventJson::serializeDay), а также в прежних
+// вариантах — без "id" и с объектом {"events": [...]} вместо массива.
+// Всё детерминировано: одни и те же параметры и зерно дают байт в байт
+// одинаковые файлы (в том числе id), поэтому замеры разных сборок сравнимы.
+class DatasetGenerator
+{
+public:
+    struct Options {
+        QDate from = QDate(2025, 1, 1);
+        QDate to = QDate(2025, 12, 31);
+        int minEventsPerDay = 3;
+        int maxEventsPerDay = 10;
+        int tagCount = 5;               // различных тегов; частоты убывают (Ципф)
+        double untaggedShare = 0.15;    // доля событий без тега
+        int descriptionLength = 40;     // средняя длина описания, символов
+        double emptyDayShare = 0.0;     // доля дней без файла
+        double legacyShare = 0.0;       // доля дней без "id" у событий
+        double wrappedShare = 0.0;      // доля дней в виде {"events": [...]}
+        quint32 seed = 1;
+    };
+
+    // Вид файла дня
+    struct FileShape {
+        bool ids = true;
+        bool wrapped = false;
+    };
+
+    struct Stats {
+        int days = 0;                   // записано файлов
+        qint64 events = 0;
+        qint64 bytes = 0;
+        int legacyDays = 0;
+        int wrappedDays = 0;
+    };
+
+    explicit DatasetGenerator(const Options &options = Options());
+
+    const Options &options() const { return m_options; }
+
+    // Имя тега по номеру: первые — «человеческие», дальше «Тег N»
+    static QString tagName(int index);
+
+    // События дня (пустой вектор — у дня нет файла) и вид его файла
+    QVector<Event> generateDay(const QDate &date) const;
+    FileShape shapeForDate(const QDate &date) const;
+
+    static QByteArray serialize(const QVector<Event> &events, const FileShape &shape);
+
+    // Файлы всех дней диапазона в dataDir (дни пишутся параллельно)
+    bool write(const QString &dataDir, Stats *stats = nullptr,
+               QString *errorString = nullptr) const;
+
+private:
+    Options m_options;
+    QVector<double> m_tagCdf;       // накопленные веса тегов, последний — 1
+
+    quint32 daySeed(const QDate &date, quint32 stream) const;
+};
+
+#endif // DATASETGENERATOR_H
@@ -0,0 +1,123 @@
+#include "daybitmap.h"
+
+#include <QtAlgorithms>
+
+namespace {
+
+// Биты [from, to) одного слова, 0 <= from < to <= 64
+quint64 wordMask(int from, int to)
+{
+    const quint64 upper = (to == 64) ? ~quint64(0) : ((quint64(1) << to) - 1);
+    return upper & ~((quint64(1) << from) - 1);
+}
+
+} // namespace
+
+void DayBitmap::clear()
+{
+    for (quint64 &word : m_words)
+        word = 0;
+}
+
+bool DayBitmap::isEmpty() const
+{
+    quint64 any = 0;
+    for (quint64 word : m_words)
+        any |= word;
+    return any == 0;
+}
+
+void DayBitmap::setRange(int first, int last)
+{
+    first = qBound(0, first, kMinutes);
+    last = qBound(0, last, kMinutes);
+    if (first >= last)
+        return;
+
+    const int firstWord = first / 64;
+    const int lastWord = (last - 1) / 64;
+    if (firstWord == lastWord) {
+        m_words[firstWord] |= wordMask(first % 64, (last - 1) % 64 + 1);
+        return;
+    }
+    m_words[firstWord] |= wordMask(first % 64, 64);
+    for (int i = firstWord + 1; i < lastWord; ++i)
+        m_words[i] = ~quint64(0);
+    m_words[lastWord] |= wordMask(0, (last - 1) % 64 + 1);
+}
+
+bool DayBitmap::test(int minute) const
+{
+    if (minute < 0 || minute >= kMinutes)
+        return false;
+    return (m_words[minute / 64] >> (minute % 64)) & 1u;
+}
+
+int DayBitmap::count() const
+{
+    int total = 0;
+    for (quint64 word : m_words)
+        total += int(qPopulationCount(word));
+    return total;
+}
+
+int DayBitmap::countRange(int first, int last) const
+{
+    first = qBound(0, first, kMinutes);
+    last = qBound(0, last, kMinutes);
+    if (first >= last)
+        return 0;
+
+    const int firstWord = first / 64;
+    const int lastWord = (last - 1) / 64;
+    if (firstWord == lastWord)
+        return int(qPopulationCount(m_words[firstWord] & wordMask(first % 64, (last - 1) % 64 + 1)));
+
+    int total = int(qPopulationCount(m_words[firstWord] & wordMask(first % 64, 64)));
+    for (int i = firstWord + 1; i < lastWord; ++i)
+        total += int(qPopulationCount(m_words[i]));
+    total += int(qPopulationCount(m_words[lastWord] & wordMask(0, (last - 1) % 64 + 1)));
+    return total;
+}
+
+DayBitmap &DayBitmap::operator|=(const DayBitmap &other)
+{
+    for (int i = 0; i < kWords; ++i)
+        m_words[i] |= other.m_words[i];
+    return *this;
+}
+
+DayBitmap &DayBitmap::operator&=(const DayBitmap &other)
+{
+    for (int i = 0; i < kWords; ++i)
+        m_words[i] &= other.m_words[i];
+    return *this;
+}
+
+DayBitmap DayBitmap::operator&(const DayBitmap &other) const
+{
+    DayBitmap result = *this;
+    result &= other;
+    return result;
+}
+
+bool DayBitmap::operator==(const DayBitmap &other) const
+{
+    for (int i = 0; i < kWords; ++i) {
+        if (m_words[i] != other.m_words[i])
+            return false;
+    }
+    return true;
+}
+
+void DayBitmap::addInterval(int start, int end, DayBitmap &day, DayBitmap &nextDay)
+{
+    if (start == end)
+        return;
+    if (end > start) {
+        day.setRange(start, end);
+    } else {
+        day.setRange(start, kMinutes);
+        nextDay.setRange(0, end);
+    }
+}
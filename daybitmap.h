@@ -0,0 +1,41 @@
+#ifndef DAYBITMAP_H
+#define DAYBITMAP_H
+
+#include <QtGlobal>
+
+// Занятость дня с точностью до минуты: 1440 бит в 23 словах по 64 бита.
+// Объединение/пересечение — поразрядные OR/AND по словам, подсчёт минут —
+// popcount; циклы фиксированной длины компилятор разворачивает и векторизует.
+class DayBitmap
+{
+public:
+    static constexpr int kMinutes = 24 * 60;
+    static constexpr int kWords = (kMinutes + 63) / 64;
+
+    void clear();
+    bool isEmpty() const;
+
+    // Минуты [first, last), 0 <= first <= last <= kMinutes
+    void setRange(int first, int last);
+    bool test(int minute) const;
+
+    // Число занятых минут — всего и в [first, last)
+    int count() const;
+    int countRange(int first, int last) const;
+
+    DayBitmap &operator|=(const DayBitmap &other);
+    DayBitmap &operator&=(const DayBitmap &other);
+    DayBitmap operator&(const DayBitmap &other) const;
+    bool operator==(const DayBitmap &other) const;
+    bool operator!=(const DayBitmap &other) const { return !(*this == other); }
+
+    // Событие [start, end) в минутах от полуночи. end < start — переход через
+    // полночь (как в TagAnalyzer::durationMinutes): до 24:00 — в day,
+    // остаток — в nextDay. start == end — пустой интервал.
+    static void addInterval(int start, int end, DayBitmap &day, DayBitmap &nextDay);
+
+private:
+    quint64 m_words[kWords] = {};
+};
+
+#endif // DAYBITMAP_H
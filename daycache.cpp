@@ -0,0 +1,257 @@
+#include "daycache.h"
+#include "trace.h"
+
+#include <QtGlobal>
+
+DayCache::DayCache(int maxDays, qint64 maxBytes)
+    : m_maxDays(qMax(1, maxDays))
+    , m_maxBytes(maxBytes)
+{
+}
+
+void DayCache::setBudget(int maxDays, qint64 maxBytes)
+{
+    m_maxDays = qMax(1, maxDays);
+    m_maxBytes = maxBytes;
+    evict();
+}
+
+bool DayCache::contains(const QDate &date) const
+{
+    return m_entries.find(date.toJulianDay()) != m_entries.end();
+}
+
+const QVector<Event> *DayCache::find(const QDate &date)
+{
+    const qint64 key = date.toJulianDay();
+
+    // Прежний открытый день больше не нужен развёрнутым; прочие горячие дни
+    // (после peek()) сворачивает evict(), когда не хватает памяти
+    if (m_current.isValid() && m_current != date) {
+        const auto previous = m_entries.find(m_current.toJulianDay());
+        if (previous != m_entries.end())
+            shrink(previous->second);
+    }
+    m_current = date;
+
+    const auto it = m_entries.find(key);
+    if (it == m_entries.end()) {
+        ++m_misses;
+        Trace::count(Trace::CacheMisses);
+        return nullptr;
+    }
+    ++m_hits;
+    Trace::count(Trace::CacheHits);
+
+    touch(it->second);
+    expand(it->second);
+    return &it->second.events;
+}
+
+const QVector<Event> *DayCache::peek(const QDate &date)
+{
+    Entry *entry = hotEntry(date);
+    return entry ? &entry->events : nullptr;
+}
+
+DayCache::Entry *DayCache::hotEntry(const QDate &date)
+{
+    const auto it = m_entries.find(date.toJulianDay());
+    if (it == m_entries.end())
+        return nullptr;
+    expand(it->second);
+    return &it->second;
+}
+
+int DayCache::indexOf(const QDate &date, const QUuid &id)
+{
+    Entry *entry = hotEntry(date);
+    return entry ? entry->byId.value(id, -1) : -1;
+}
+
+bool DayCache::append(const QDate &date, const Event &e)
+{
+    Entry *entry = hotEntry(date);
+    if (!entry)
+        return false;
+    entry->byId.insert(e.id, entry->events.size());
+    entry->events.append(e);
+    return true;
+}
+
+bool DayCache::replace(const QDate &date, int index, const Event &e)
+{
+    Entry *entry = hotEntry(date);
+    if (!entry || index < 0 || index >= entry->events.size())
+        return false;
+    Event &slot = entry->events[index];
+    if (slot.id != e.id) {
+        entry->byId.remove(slot.id);
+        entry->byId.insert(e.id, index);
+    }
+    slot = e;
+    return true;
+}
+
+bool DayCache::removeAt(const QDate &date, int index, Event *removed)
+{
+    Entry *entry = hotEntry(date);
+    if (!entry || index < 0 || index >= entry->events.size())
+        return false;
+
+    QVector<Event> &events = entry->events;
+    entry->byId.remove(events.at(index).id);
+    if (removed)
+        *removed = events.at(index);
+
+    // Последнее событие — на место удалённого: без сдвига хвоста и переиндексации
+    const int last = events.size() - 1;
+    if (index != last) {
+        events[index] = events.at(last);
+        entry->byId.insert(events.at(index).id, index);
+    }
+    events.removeLast();
+    return true;
+}
+
+void DayCache::insert(const QDate &date, const QVector<Event> &events,
+                      const DayStore::Signature &sig)
+{
+    const qint64 key = date.toJulianDay();
+    auto it = m_entries.find(key);
+    if (it == m_entries.end()) {
+        m_lru.push_front(key);
+        it = m_entries.emplace(key, Entry()).first;
+        it->second.lru = m_lru.begin();
+    } else {
+        touch(it->second);
+    }
+
+    Entry &entry = it->second;
+    entry.columns = EventColumns(events, m_tags);
+    entry.events = QVector<Event>();
+    entry.byId = QHash<QUuid, int>();
+    entry.hot = false;
+    entry.sig = sig;
+    entry.dirty = false;
+    updateBytes(entry);
+    evict();
+}
+
+void DayCache::remove(const QDate &date)
+{
+    const auto it = m_entries.find(date.toJulianDay());
+    if (it == m_entries.end())
+        return;
+    m_bytes -= it->second.bytes;
+    m_lru.erase(it->second.lru);
+    m_entries.erase(it);
+}
+
+void DayCache::markDirty(const QDate &date)
+{
+    const auto it = m_entries.find(date.toJulianDay());
+    if (it == m_entries.end())
+        return;
+    it->second.dirty = true;
+    updateBytes(it->second);
+}
+
+void DayCache::markClean(const QDate &date, const DayStore::Signature &sig)
+{
+    const auto it = m_entries.find(date.toJulianDay());
+    if (it == m_entries.end())
+        return;
+    it->second.dirty = false;
+    it->second.sig = sig;
+    updateBytes(it->second);
+    evict();
+}
+
+bool DayCache::isDirty(const QDate &date) const
+{
+    const auto it = m_entries.find(date.toJulianDay());
+    return it != m_entries.end() && it->second.dirty;
+}
+
+DayStore::Signature DayCache::signature(const QDate &date) const
+{
+    const auto it = m_entries.find(date.toJulianDay());
+    return it == m_entries.end() ? DayStore::Signature() : it->second.sig;
+}
+
+void DayCache::touch(Entry &entry)
+{
+    m_lru.splice(m_lru.begin(), m_lru, entry.lru);
+}
+
+void DayCache::updateBytes(Entry &entry)
+{
+    m_bytes -= entry.bytes;
+    entry.bytes = entry.hot ? estimateBytes(entry.events) : entry.columns.bytes();
+    m_bytes += entry.bytes;
+}
+
+void DayCache::evict()
+{
+    const qint64 current = m_current.toJulianDay();     // у пустой даты не совпадёт ни с каким днём
+
+    // Сначала сворачиваем развёрнутые чистые дни, кроме открытого: часто этого
+    // достаточно, чтобы уложиться в бюджет памяти без вытеснения
+    for (auto it = m_lru.rbegin(); it != m_lru.rend() && m_bytes > m_maxBytes; ++it) {
+        if (*it != current)
+            shrink(m_entries.at(*it));
+    }
+
+    // Идём от самых старых; самый свежий день (обычно открытый) не трогаем никогда
+    auto it = m_lru.end();
+    while ((int(m_entries.size()) > m_maxDays || m_bytes > m_maxBytes) && it != m_lru.begin()) {
+        --it;
+        if (it == m_lru.begin())
+            break;
+
+        const auto entryIt = m_entries.find(*it);
+        if (entryIt->second.dirty || *it == current)
+            continue;   // не записан или сейчас открыт — держим
+
+        m_bytes -= entryIt->second.bytes;
+        m_entries.erase(entryIt);
+        it = m_lru.erase(it);
+    }
+}
+
+void DayCache::expand(Entry &entry)
+{
+    if (entry.hot)
+        return;
+    entry.events = entry.columns.toEvents(m_tags);
+    entry.columns = EventColumns();
+    entry.byId.clear();
+    entry.byId.reserve(entry.events.size());
+    for (int i = 0; i < entry.events.size(); ++i)
+        entry.byId.insert(entry.events.at(i).id, i);
+    entry.hot = true;
+    updateBytes(entry);
+}
+
+void DayCache::shrink(Entry &entry)
+{
+    // Незаписанные правки остаются в развёрнутом виде до записи
+    if (!entry.hot || entry.dirty)
+        return;
+    entry.columns = EventColumns(entry.events, m_tags);
+    entry.events = QVector<Event>();
+    entry.byId = QHash<QUuid, int>();
+    entry.hot = false;
+    updateBytes(entry);
+}
+
+qint64 DayCache::estimateBytes(const QVector<Event> &events)
+{
+    qint64 bytes = qint64(sizeof(QVector<Event>)) + qint64(events.capacity()) * qint64(sizeof(Event));
+    for (const Event &e : events) {
+        bytes += (e.title.capacity() + e.tag.capacity() + e.description.capacity())
+                 * qint64(sizeof(QChar));
+    }
+    return bytes;
+}
@@ -0,0 +1,108 @@
+#ifndef DAYCACHE_H
+#define DAYCACHE_H
+
+#include <QDate>
+#include <QHash>
+#include <QUuid>
+#include <QVector>
+#include <list>
+#include <unordered_map>
+#include "daystore.h"
+#include "event.h"
+#include "eventcolumns.h"
+
+// Кэш загруженных дней с ограничением по числу дней и по оценке памяти.
+// Вытесняются давно не открывавшиеся «чистые» дни; «грязные» (изменённые,
+// но ещё не записанные) держатся, пока не будут записаны (markClean).
+//
+// Дни хранятся компактно (EventColumns с общим словарём тегов). В QVector<Event>
+// день разворачивается при обращении через find()/peek(). Открытый день
+// (последний find()) остаётся развёрнутым («горячим») и не вытесняется, пока
+// пользователь не перейдёт к другому дню; указатель на его события валиден до
+// следующего find() или remove(). Прочие дни, развёрнутые через peek() и
+// правки, evict() сворачивает или вытесняет при нехватке бюджета, поэтому их
+// указатели живут только до следующей вставки или markClean().
+//
+// У горячего дня есть индекс id → позиция в векторе; поэтому события дня
+// меняются только через append()/replace()/removeAt(), которые держат его
+// в согласии с вектором. Порядок событий в векторе не значим (сортирует
+// EventListModel): удаление переносит последнее событие на место удалённого.
+class DayCache
+{
+public:
+    explicit DayCache(int maxDays = 256, qint64 maxBytes = 32 * 1024 * 1024);
+
+    void setBudget(int maxDays, qint64 maxBytes);
+    int maxDays() const     { return m_maxDays; }
+    qint64 maxBytes() const { return m_maxBytes; }
+
+    bool contains(const QDate &date) const;
+
+    // Переход к дню (он становится открытым): учёт LRU и счётчиков попаданий,
+    // прежний открытый день сворачивается обратно в колонки. nullptr — дня нет
+    // в кэше (открытым он всё равно считается — до вставки)
+    const QVector<Event> *find(const QDate &date);
+    // Доступ к дню без учёта LRU и счётчиков
+    const QVector<Event> *peek(const QDate &date);
+
+    // Позиция события в векторе дня по id, O(1); -1 — нет дня или события
+    int indexOf(const QDate &date, const QUuid &id);
+    // Правки событий дня (день должен быть в кэше); индекс по id обновляется
+    bool append(const QDate &date, const Event &e);
+    bool replace(const QDate &date, int index, const Event &e);
+    bool removeAt(const QDate &date, int index, Event *removed = nullptr);
+
+    // Вставка (или замена) чистого дня с подписью его файлов; хранится компактно
+    void insert(const QDate &date, const QVector<Event> &events,
+                const DayStore::Signature &sig);
+    void remove(const QDate &date);
+
+    // День изменён в памяти — не вытеснять до записи
+    void markDirty(const QDate &date);
+    // День записан; sig — подпись файлов после записи
+    void markClean(const QDate &date, const DayStore::Signature &sig);
+    bool isDirty(const QDate &date) const;
+
+    // Подпись файлов на момент загрузки/записи (пустая, если дня нет)
+    DayStore::Signature signature(const QDate &date) const;
+
+    int size() const      { return int(m_entries.size()); }
+    qint64 bytes() const  { return m_bytes; }
+    int hits() const      { return m_hits; }
+    int misses() const    { return m_misses; }
+
+private:
+    struct Entry {
+        EventColumns columns;       // компактная форма (когда !hot)
+        QVector<Event> events;      // развёрнутая форма (когда hot)
+        QHash<QUuid, int> byId;     // id → позиция в events (когда hot)
+        bool hot = false;
+        DayStore::Signature sig;
+        bool dirty = false;
+        qint64 bytes = 0;
+        std::list<qint64>::iterator lru;
+    };
+
+    // Ключ — юлианский день. unordered_map не переносит элементы при
+    // перехешировании, поэтому ссылки на события стабильны.
+    std::unordered_map<qint64, Entry> m_entries;
+    std::list<qint64> m_lru;      // в начале — самые свежие
+    TagDictionary m_tags;
+    QDate m_current;              // открытый день — последний find()
+    int m_maxDays;
+    qint64 m_maxBytes;
+    qint64 m_bytes = 0;
+    int m_hits = 0;
+    int m_misses = 0;
+
+    void touch(Entry &entry);
+    void updateBytes(Entry &entry);
+    void evict();
+    void expand(Entry &entry);
+    void shrink(Entry &entry);
+    Entry *hotEntry(const QDate &date);
+
+    static qint64 estimateBytes(const QVector<Event> &events);
+};
+
+#endif // DAYCACHE_H
@@ -0,0 +1,345 @@
+#include "daymanifest.h"
+#include "taganalyzer.h"
+#include "trace.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QSet>
+
+namespace {
+
+const quint32 kMagic   = 0x314d5454;   // "TTM1"
+const quint32 kVersion = 1;
+
+// Экземпляры shared() и каталоги, файл которых ведёт владелец (окно)
+struct SharedManifests
+{
+    QMutex mutex;
+    QHash<QString, std::shared_ptr<DayManifest>> byDir;
+    QSet<QString> owned;
+};
+
+SharedManifests &sharedManifests()
+{
+    static SharedManifests manifests;
+    return manifests;
+}
+
+// Один каталог может прийти разными путями (./data и абсолютный)
+QString dirKey(const QString &dataDir)
+{
+    return QDir::cleanPath(QFileInfo(dataDir).absoluteFilePath());
+}
+
+} // namespace
+
+DayManifest::DayManifest(const QString &dataDir)
+    : m_store(dataDir)
+{
+}
+
+DayManifest::~DayManifest()
+{
+    if (!m_owner)
+        return;
+    SharedManifests &shared = sharedManifests();
+    QMutexLocker locker(&shared.mutex);
+    shared.owned.remove(dirKey(m_store.dataDir()));
+}
+
+QString DayManifest::manifestPath(const QString &dataDir)
+{
+    return dataDir + "/archive/manifest.dat";
+}
+
+bool DayManifest::open(QString *errorString)
+{
+    TRACE_SCOPE("DayManifest::open");
+    {
+        SharedManifests &shared = sharedManifests();
+        QMutexLocker locker(&shared.mutex);
+        shared.owned.insert(dirKey(m_store.dataDir()));
+    }
+    m_owner = true;
+
+    // Нет файла, он несовместим или каталог с тех пор менялся — сверяемся
+    if (!load() || m_dirMtime != dirMtime())
+        syncWithDirectory();
+    return save(errorString);
+}
+
+std::shared_ptr<const DayManifest> DayManifest::shared(const QString &dataDir)
+{
+    SharedManifests &shared = sharedManifests();
+    const QString key = dirKey(dataDir);
+    // Под блокировкой и сверка: параллельные вызовы дождутся одной сверки
+    QMutexLocker locker(&shared.mutex);
+    std::shared_ptr<DayManifest> &current = shared.byDir[key];
+    if (current && current->m_dirMtime == current->dirMtime())
+        return current;
+
+    TRACE_SCOPE("DayManifest::shared");
+    // Прежний экземпляр не трогаем — его могут держать другие потоки
+    auto next = std::make_shared<DayManifest>(dataDir);
+    next->load();
+    // Прошлая сверка в памяти свежее файла (владелец ещё не сохранил) — от неё
+    if (current && current->m_dirMtime > next->m_dirMtime)
+        *next = *current;
+    if (next->m_dirMtime != next->dirMtime()) {
+        next->syncWithDirectory();
+        // Не записалось — не страшно: в памяти содержимое актуально
+        if (!shared.owned.contains(key))
+            next->save();
+    }
+    current = next;
+    return current;
+}
+
+bool DayManifest::load()
+{
+    m_dirMtime = 0;
+    m_base = 0;
+    m_bits.clear();
+    m_days.clear();
+    m_dirty = false;
+
+    QFile file(manifestPath(m_store.dataDir()));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_12);
+
+    quint32 magic = 0, version = 0, count = 0;
+    in >> magic >> version;
+    if (magic != kMagic || version != kVersion)
+        return false;
+
+    in >> m_dirMtime >> m_base >> m_bits >> count;
+    m_days.reserve(int(qMin<quint32>(count, 1 << 16)));   // счётчику из файла не доверяем
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        qint64 julianDay = 0;
+        DayInfo info;
+        in >> julianDay >> info.eventCount >> info.minutes
+           >> info.sig.jsonMtime >> info.sig.jsonSize
+           >> info.sig.journalMtime >> info.sig.journalSize;
+        m_days.insert(julianDay, info);
+    }
+
+    // Оборванный файл — как отсутствующий: пересоберём по каталогу
+    if (in.status() != QDataStream::Ok) {
+        m_dirMtime = 0;
+        m_base = 0;
+        m_bits.clear();
+        m_days.clear();
+        return false;
+    }
+    return true;
+}
+
+bool DayManifest::save(QString *errorString)
+{
+    if (!m_dirty)
+        return true;
+
+    const QString path = manifestPath(m_store.dataDir());
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    // Владелец: создание папки archive тоже меняет время каталога
+    if (m_owner)
+        m_dirMtime = dirMtime();
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorString)
+            *errorString = "Не удалось открыть оглавление для записи: " + path + "\n" + file.errorString();
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << kMagic << kVersion << m_dirMtime << m_base << m_bits << quint32(m_days.size());
+    for (auto it = m_days.constBegin(); it != m_days.constEnd(); ++it) {
+        const DayInfo &info = it.value();
+        out << it.key() << info.eventCount << info.minutes
+            << info.sig.jsonMtime << info.sig.jsonSize
+            << info.sig.journalMtime << info.sig.journalSize;
+    }
+
+    if (out.status() != QDataStream::Ok || !file.commit()) {
+        if (errorString)
+            *errorString = "Не удалось записать оглавление: " + path + "\n" + file.errorString();
+        return false;
+    }
+    m_dirty = false;
+    return true;
+}
+
+void DayManifest::syncWithDirectory()
+{
+    TRACE_SCOPE("DayManifest::syncWithDirectory");
+    // Время каталога — до листинга: файл, созданный во время сверки, даст новую сверку
+    m_dirMtime = dirMtime();
+    m_dirty = true;
+
+    // Подписи дней — из того же листинга (как DayStore::signature), без stat() по дням
+    QHash<qint64, DayStore::Signature> present;
+    const QFileInfoList entries = QDir(m_store.dataDir()).entryInfoList(
+        { QStringLiteral("*.json"), QStringLiteral("*.journal") }, QDir::Files);
+    for (const QFileInfo &entry : entries) {
+        const QDate date = QDate::fromString(entry.fileName().section('.', 0, 0), QStringLiteral("yyyy-MM-dd"));
+        if (!date.isValid())
+            continue;
+        DayStore::Signature &sig = present[date.toJulianDay()];
+        if (entry.suffix() == QLatin1String("json")) {
+            sig.jsonMtime = entry.lastModified().toMSecsSinceEpoch();
+            sig.jsonSize  = entry.size();
+        } else {
+            sig.journalMtime = entry.lastModified().toMSecsSinceEpoch();
+            sig.journalSize  = entry.size();
+        }
+    }
+
+    const QList<qint64> known = m_days.keys();
+    for (qint64 key : known) {
+        if (!present.contains(key)) {
+            m_days.remove(key);
+            setPresent(key, false);
+        }
+    }
+
+    // Разбираются только новые дни и дни, файлы которых изменились с подсчёта
+    for (auto it = present.constBegin(); it != present.constEnd(); ++it) {
+        const qint64 key = it.key();
+        const auto known = m_days.constFind(key);
+        if (known != m_days.constEnd() && known.value().sig == it.value())
+            continue;
+        const QDate date = QDate::fromJulianDay(key);
+        const DayStore::Signature sig = m_store.signature(date);
+        QVector<Event> events;
+        if (!m_store.loadFields(date, events, EventScanner::TimeAndTag))
+            events.clear();     // битый день — есть, но пустой
+        m_days.insert(key, summarize(events, sig));
+        setPresent(key, true);
+    }
+}
+
+void DayManifest::update(const QDate &date, const QVector<Event> &events,
+                         const DayStore::Signature &sig)
+{
+    // Каталог изменила эта запись: без этого сохранённое оглавление всегда
+    // выглядело бы устаревшим. Чужие правки владелец узнаёт от слежения за
+    // каталогом и вносит сюда же.
+    const qint64 mtime = dirMtime();
+    if (mtime != m_dirMtime) {
+        m_dirMtime = mtime;
+        m_dirty = true;
+    }
+
+    const qint64 key = date.toJulianDay();
+    if (!sig.exists()) {
+        if (m_days.remove(key) > 0) {
+            setPresent(key, false);
+            m_dirty = true;
+        }
+        return;
+    }
+    m_days.insert(key, summarize(events, sig));
+    setPresent(key, true);
+    m_dirty = true;
+}
+
+bool DayManifest::hasData(const QDate &date) const
+{
+    const qint64 bit = date.toJulianDay() - m_base;
+    return bit >= 0 && bit < m_bits.size() && m_bits.testBit(int(bit));
+}
+
+DayManifest::DayInfo DayManifest::info(const QDate &date) const
+{
+    return m_days.value(date.toJulianDay());
+}
+
+QVector<QDate> DayManifest::days(const QDate &from, const QDate &to) const
+{
+    QVector<QDate> result;
+    if (!from.isValid() || !to.isValid() || m_bits.isEmpty())
+        return result;
+    const qint64 first = qMax<qint64>(from.toJulianDay() - m_base, 0);
+    const qint64 last = qMin<qint64>(to.toJulianDay() - m_base, m_bits.size() - 1);
+    for (qint64 bit = first; bit <= last; ++bit) {
+        if (m_bits.testBit(int(bit)))
+            result.append(QDate::fromJulianDay(m_base + bit));
+    }
+    return result;
+}
+
+QDate DayManifest::firstDay() const
+{
+    for (int bit = 0; bit < m_bits.size(); ++bit) {
+        if (m_bits.testBit(bit))
+            return QDate::fromJulianDay(m_base + bit);
+    }
+    return QDate();
+}
+
+QDate DayManifest::lastDay() const
+{
+    for (int bit = m_bits.size() - 1; bit >= 0; --bit) {
+        if (m_bits.testBit(bit))
+            return QDate::fromJulianDay(m_base + bit);
+    }
+    return QDate();
+}
+
+void DayManifest::setPresent(qint64 julianDay, bool on)
+{
+    if (m_bits.isEmpty()) {
+        if (!on)
+            return;
+        m_base = julianDay;
+    }
+
+    qint64 bit = julianDay - m_base;
+    if (bit < 0) {
+        if (!on)
+            return;
+        // Более ранний день: сдвигаем карту, чтобы он стал битом 0
+        QBitArray shifted(m_bits.size() - int(bit));
+        for (int i = 0; i < m_bits.size(); ++i) {
+            if (m_bits.testBit(i))
+                shifted.setBit(i - int(bit));
+        }
+        m_bits = shifted;
+        m_base = julianDay;
+        bit = 0;
+    } else if (bit >= m_bits.size()) {
+        if (!on)
+            return;
+        m_bits.resize(int(bit) + 1);
+    }
+    m_bits.setBit(int(bit), on);
+}
+
+qint64 DayManifest::dirMtime() const
+{
+    const QFileInfo dir(m_store.dataDir());
+    return dir.exists() ? dir.lastModified().toMSecsSinceEpoch() : 0;
+}
+
+DayManifest::DayInfo DayManifest::summarize(const QVector<Event> &events,
+                                            const DayStore::Signature &sig)
+{
+    DayInfo info;
+    info.sig = sig;
+    info.eventCount = events.size();
+    for (const Event &e : events)
+        info.minutes += TagAnalyzer::durationMinutes(e.start, e.end);
+    return info;
+}
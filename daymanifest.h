@@ -0,0 +1,87 @@
+#ifndef DAYMANIFEST_H
+#define DAYMANIFEST_H
+
+#include <QBitArray>
+#include <QDate>
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <memory>
+#include "daystore.h"
+#include "event.h"
+
+// Оглавление каталога данных (dataDir/archive/manifest.dat): битовая карта
+// дней, для которых есть файлы, и по каждому такому дню — число событий и
+// занятые минуты. Вопрос «в какие дни есть записи» решается без обращения
+// к файлам дней: календарь подсвечивает занятые дни, анализ диапазона
+// пропускает пустые даты.
+//
+// Свежесть: запоминается время изменения каталога на момент последней
+// сверки. Создание, удаление или атомарная замена файла дня меняет его —
+// тогда при открытии листинг каталога (один проход, подписи дней берутся
+// из него же) сверяется с оглавлением: новые дни и дни с другой подписью
+// разбираются, пропавшие удаляются. Правки на месте (дозапись журнала)
+// каталог не меняют — их вносит update() после записи.
+// Не потокобезопасен: один экземпляр — один поток. Файл каталога пишет его
+// владелец (окно, open()/save()): он вносит свои записи через update() и
+// держит время каталога в файле свежим. Остальные (анализ) берут общий на
+// процесс экземпляр через shared() — только из фоновых потоков.
+class DayManifest
+{
+public:
+    struct DayInfo {
+        int eventCount = 0;
+        int minutes = 0;                // сумма длительностей событий дня
+        DayStore::Signature sig;        // подпись файлов на момент подсчёта
+    };
+
+    explicit DayManifest(const QString &dataDir);
+    ~DayManifest();
+
+    static QString manifestPath(const QString &dataDir);
+
+    // Чтение с диска и при необходимости сверка с каталогом (с записью);
+    // экземпляр становится владельцем файла каталога.
+    // false — только если не удалось записать: содержимое при этом актуально.
+    bool open(QString *errorString = nullptr);
+    bool save(QString *errorString = nullptr);
+
+    // Оглавление каталога для чтения, общее на процесс. Пока каталог не
+    // меняется, возвращается тот же экземпляр без обращения к диску; после
+    // изменений перечитывается файл (его обновляет владелец), а если и он
+    // отстал — сверка, при которой разбираются только изменившиеся дни.
+    // Файл каталога без владельца в процессе сохраняется после сверки.
+    // Потокобезопасна; зовётся из фоновых потоков — сверка читает файлы.
+    static std::shared_ptr<const DayManifest> shared(const QString &dataDir);
+
+    // День записан или перечитан: события и подпись файлов после записи.
+    // Подпись без файлов — день удалён из оглавления.
+    void update(const QDate &date, const QVector<Event> &events, const DayStore::Signature &sig);
+
+    bool hasData(const QDate &date) const;
+    DayInfo info(const QDate &date) const;
+    // Дни с файлами в [from, to] по возрастанию
+    QVector<QDate> days(const QDate &from, const QDate &to) const;
+    QDate firstDay() const;
+    QDate lastDay() const;
+
+    bool isDirty() const { return m_dirty; }
+
+private:
+    DayStore m_store;
+    qint64 m_dirMtime = 0;          // время изменения каталога при последней сверке
+    qint64 m_base = 0;              // юлианский день бита 0
+    QBitArray m_bits;
+    QHash<qint64, DayInfo> m_days;  // ключ — юлианский день
+    bool m_dirty = false;
+    bool m_owner = false;
+
+    bool load();
+    void syncWithDirectory();
+    void setPresent(qint64 julianDay, bool on);
+    qint64 dirMtime() const;
+
+    static DayInfo summarize(const QVector<Event> &events, const DayStore::Signature &sig);
+};
+
+#endif // DAYMANIFEST_H
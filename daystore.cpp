@@ -0,0 +1,394 @@
+#include "daystore.h"
+#include "eventjson.h"
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+
+namespace {
+
+// Чтение, дозапись и сворачивание журналов идут через один мьютекс:
+// иначе можно прочитать старый снимок и уже удалённый компактором журнал.
+QMutex g_journalMutex;
+
+// Порог размера журнала, после которого его стоит свернуть в снимок
+const qint64 kCompactThresholdBytes = 64 * 1024;
+
+// Попыток DayStore::modify() без блокировки, пока день меняется из других потоков
+const int kModifyRetries = 3;
+
+// Отсутствующий файл — не ошибка: data остаётся пустым
+bool readFile(const QString &filename, QByteArray &data, QString *errorString)
+{
+    data.clear();
+    QFile file(filename);
+    if (!file.exists())
+        return true;
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorString)
+            *errorString = "Не удалось открыть файл: " + filename + "\n" + file.errorString();
+        return false;
+    }
+    data = file.readAll();
+    Trace::count(Trace::FilesRead);
+    return true;
+}
+
+// Содержимое во временный файл QSaveFile; commit() — за вызывающим
+bool writeUncommitted(QSaveFile &file, const QByteArray &bytes, QString *errorString)
+{
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorString)
+            *errorString = "Не удалось открыть файл для записи: " + file.fileName() + "\n" + file.errorString();
+        return false;
+    }
+    if (file.write(bytes) != bytes.size()) {
+        if (errorString)
+            *errorString = "Не удалось записать все данные в файл: " + file.fileName();
+        return false;
+    }
+    return true;
+}
+
+int indexOfId(const QVector<Event> &events, const QUuid &id)
+{
+    for (int i = 0; i < events.size(); ++i) {
+        if (events[i].id == id) return i;
+    }
+    return -1;
+}
+
+// Проигрывание журнала поверх снимка. Записи идемпотентны (add/update —
+// вставка-или-замена по id, delete — удаление по id), поэтому повторное
+// проигрывание после сбоя между записью снимка и удалением журнала безопасно.
+void applyJournal(const QByteArray &journal, QVector<Event> &events)
+{
+    if (journal.isEmpty())
+        return;
+    TRACE_SCOPE("applyJournal");
+    Trace::count(Trace::BytesParsed, journal.size());
+
+    const QList<QByteArray> lines = journal.split('\n');
+    for (const QByteArray &line : lines) {
+        if (line.trimmed().isEmpty())
+            continue;
+
+        const QJsonDocument doc = QJsonDocument::fromJson(line);
+        if (!doc.isObject())
+            continue; // оборванная запись (сбой во время дозаписи) — пропускаем
+
+        const QJsonObject obj = doc.object();
+        const QUuid id = QUuid::fromString(obj.value(QStringLiteral("id")).toString());
+        if (id.isNull())
+            continue;
+
+        const int index = indexOfId(events, id);
+        if (obj.value(QStringLiteral("op")).toString() == QLatin1String("delete")) {
+            if (index >= 0)
+                events.removeAt(index);
+        } else if (index >= 0) {
+            events[index] = EventJson::fromJson(obj);
+        } else {
+            events.append(EventJson::fromJson(obj));
+        }
+    }
+}
+
+QString opName(DayStore::JournalOp op)
+{
+    switch (op) {
+    case DayStore::JournalOp::Add:    return QStringLiteral("add");
+    case DayStore::JournalOp::Update: return QStringLiteral("update");
+    case DayStore::JournalOp::Delete: return QStringLiteral("delete");
+    }
+    return QString();
+}
+
+} // namespace
+
+DayStore::DayStore(const QString &dataDir)
+    : m_dataDir(dataDir)
+{
+}
+
+QString DayStore::defaultDataDir()
+{
+    const QString base = QCoreApplication::applicationDirPath() + "/data";
+    QDir().mkpath(base);  // гарантируем наличие папки
+    return base;
+}
+
+QString DayStore::filePathForDate(const QDate &date) const
+{
+    return m_dataDir + "/" + date.toString("yyyy-MM-dd") + ".json";
+}
+
+QString DayStore::journalPathForDate(const QDate &date) const
+{
+    return m_dataDir + "/" + date.toString("yyyy-MM-dd") + ".journal";
+}
+
+DayStore::Signature DayStore::signature(const QDate &date) const
+{
+    Signature sig;
+    const QFileInfo json(filePathForDate(date));
+    if (json.exists()) {
+        sig.jsonMtime = json.lastModified().toMSecsSinceEpoch();
+        sig.jsonSize  = json.size();
+    }
+    const QFileInfo journal(journalPathForDate(date));
+    if (journal.exists()) {
+        sig.journalMtime = journal.lastModified().toMSecsSinceEpoch();
+        sig.journalSize  = journal.size();
+    }
+    return sig;
+}
+
+bool DayStore::load(const QDate &date, QVector<Event> &events,
+                    bool *generatedIds, QString *errorString) const
+{
+    TRACE_SCOPE("DayStore::load");
+    events.clear();
+    if (generatedIds) *generatedIds = false;
+
+    const QString filename = filePathForDate(date);
+    QByteArray snapshot, journal;
+    {
+        QMutexLocker locker(&g_journalMutex);
+        if (!readFile(filename, snapshot, errorString)
+            || !readFile(journalPathForDate(date), journal, errorString))
+            return false;
+    }
+
+    int missingIds = 0;
+    if (!snapshot.isEmpty()) {
+        QString parseError;
+        if (!EventJson::parseDay(snapshot, events, &missingIds, &parseError)) {
+            if (errorString)
+                *errorString = parseError + "\n" + filename;
+            return false;
+        }
+    }
+
+    applyJournal(journal, events);
+
+    if (missingIds > 0) {
+        for (Event &e : events) {
+            if (e.id.isNull())
+                e.id = QUuid::createUuid();
+        }
+        if (generatedIds) *generatedIds = true;
+    }
+    return true;
+}
+
+bool DayStore::loadFields(const QDate &date, QVector<Event> &events,
+                          EventScanner::Fields fields, QString *errorString) const
+{
+    TRACE_SCOPE("DayStore::loadFields");
+    events.clear();
+
+    const QString filename = filePathForDate(date);
+    QByteArray snapshot, journal;
+    {
+        QMutexLocker locker(&g_journalMutex);
+        if (!readFile(filename, snapshot, errorString)
+            || !readFile(journalPathForDate(date), journal, errorString))
+            return false;
+    }
+
+    // Журнал сопоставляет записи по id
+    if (!journal.isEmpty())
+        fields |= EventScanner::Id;
+
+    if (!snapshot.isEmpty()) {
+        QString parseError;
+        if (!EventScanner::parseDay(snapshot, events, fields, nullptr, &parseError)) {
+            if (errorString)
+                *errorString = parseError + "\n" + filename;
+            return false;
+        }
+    }
+
+    applyJournal(journal, events);
+    return true;
+}
+
+bool DayStore::save(const QDate &date, const QVector<Event> &events,
+                    QString *errorString) const
+{
+    TRACE_SCOPE("DayStore::save");
+    QMutexLocker locker(&g_journalMutex);
+    if (!writeSnapshot(filePathForDate(date), events, errorString))
+        return false;
+
+    // Снимок теперь полный — журнал больше не нужен
+    QFile::remove(journalPathForDate(date));
+    return true;
+}
+
+bool DayStore::modify(const QDate &date, const std::function<bool(QVector<Event> &)> &edit,
+                      QString *errorString) const
+{
+    TRACE_SCOPE("DayStore::modify");
+    const QString filename = filePathForDate(date);
+    QDir().mkpath(QFileInfo(filename).absolutePath()); // гарантируем наличие папки
+
+    // Блокировка журналов держится только на чтении и на подмене файлов:
+    // разбор, правка и запись временного файла идут без неё — параллельно
+    // с другими днями и не задерживая окно. Если день успел измениться
+    // (подпись до и после не совпала), проход повторяется; после
+    // kModifyRetries попыток — целиком под блокировкой.
+    for (int attempt = 0; ; ++attempt) {
+        const bool exclusive = attempt >= kModifyRetries;
+
+        QMutexLocker locker(&g_journalMutex);
+        QByteArray snapshot, journal;
+        if (!readFile(filename, snapshot, errorString)
+            || !readFile(journalPathForDate(date), journal, errorString))
+            return false;
+        const Signature before = signature(date);
+        if (!exclusive)
+            locker.unlock();
+
+        QVector<Event> events;
+        int missingIds = 0;
+        if (!snapshot.isEmpty()) {
+            QString parseError;
+            if (!EventJson::parseDay(snapshot, events, &missingIds, &parseError)) {
+                if (errorString)
+                    *errorString = parseError + "\n" + filename;
+                return false;
+            }
+        }
+        applyJournal(journal, events);
+        for (Event &e : events) {
+            if (e.id.isNull())
+                e.id = QUuid::createUuid();
+        }
+
+        if (!edit(events) && missingIds == 0)
+            return true;
+
+        QSaveFile file(filename);
+        if (!writeUncommitted(file, EventJson::serializeDay(events), errorString))
+            return false;
+
+        if (!exclusive) {
+            locker.relock();
+            if (signature(date) != before) {
+                file.cancelWriting();
+                continue;
+            }
+        }
+        if (!file.commit()) {
+            if (errorString)
+                *errorString = "Не удалось завершить запись файла: " + filename + "\n" + file.errorString();
+            return false;
+        }
+        Trace::count(Trace::FilesWritten);
+        QFile::remove(journalPathForDate(date));
+        return true;
+    }
+}
+
+bool DayStore::appendToJournal(const QDate &date, JournalOp op, const Event &e,
+                               QString *errorString) const
+{
+    return appendToJournal(date, QVector<JournalRecord>{ { op, e } }, errorString);
+}
+
+bool DayStore::appendToJournal(const QDate &date, const QVector<JournalRecord> &records,
+                               QString *errorString) const
+{
+    if (records.isEmpty())
+        return true;
+    TRACE_SCOPE("DayStore::appendToJournal");
+
+    QByteArray lines;
+    for (const JournalRecord &record : records) {
+        QJsonObject obj;
+        if (record.op == JournalOp::Delete)
+            obj["id"] = record.event.id.toString(QUuid::WithoutBraces);
+        else
+            obj = EventJson::toJson(record.event);
+        obj["op"] = opName(record.op);
+
+        lines += QJsonDocument(obj).toJson(QJsonDocument::Compact);
+        lines += '\n';
+    }
+
+    const QString filename = journalPathForDate(date);
+    QDir().mkpath(QFileInfo(filename).absolutePath()); // гарантируем наличие папки
+
+    QMutexLocker locker(&g_journalMutex);
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        if (errorString)
+            *errorString = "Не удалось открыть журнал для записи: " + filename + "\n" + file.errorString();
+        return false;
+    }
+    if (file.write(lines) != lines.size() || !file.flush()) {
+        if (errorString)
+            *errorString = "Не удалось дописать журнал: " + filename + "\n" + file.errorString();
+        return false;
+    }
+    Trace::count(Trace::FilesWritten);
+    return true;
+}
+
+bool DayStore::needsCompaction(const QDate &date) const
+{
+    return QFileInfo(journalPathForDate(date)).size() > kCompactThresholdBytes;
+}
+
+bool DayStore::compact(const QDate &date, QString *errorString) const
+{
+    TRACE_SCOPE("DayStore::compact");
+    const QString filename = filePathForDate(date);
+
+    QMutexLocker locker(&g_journalMutex);
+    QByteArray snapshot, journal;
+    if (!readFile(filename, snapshot, errorString)
+        || !readFile(journalPathForDate(date), journal, errorString))
+        return false;
+    if (journal.isEmpty())
+        return true;
+
+    QVector<Event> events;
+    if (!snapshot.isEmpty() && !EventJson::parseDay(snapshot, events, nullptr, errorString))
+        return false;
+
+    applyJournal(journal, events);
+
+    if (!writeSnapshot(filename, events, errorString))
+        return false;
+    QFile::remove(journalPathForDate(date));
+    return true;
+}
+
+bool DayStore::writeSnapshot(const QString &filename, const QVector<Event> &events,
+                             QString *errorString) const
+{
+    QDir().mkpath(QFileInfo(filename).absolutePath()); // гарантируем наличие папки
+
+    QSaveFile file(filename);               // атомарная запись
+    if (!writeUncommitted(file, EventJson::serializeDay(events), errorString))
+        return false;
+
+    if (!file.commit()) {
+        if (errorString)
+            *errorString = "Не удалось завершить запись файла: " + filename + "\n" + file.errorString();
+        return false;
+    }
+    Trace::count(Trace::FilesWritten);
+    return true;
+}
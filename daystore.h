@@ -0,0 +1,107 @@
+#ifndef DAYSTORE_H
+#define DAYSTORE_H
+
+#include <QDate>
+#include <QMetaType>
+#include <QString>
+#include <QVector>
+#include <functional>
+#include "event.h"
+#include "eventscanner.h"
+
+// Хранилище событий по дням в каталоге dataDir:
+//   yyyy-MM-dd.json     — снимок дня (массив событий, как и раньше);
+//   yyyy-MM-dd.journal  — журнал правок поверх снимка, по одной JSON-записи
+//                         в строке: {"op":"add|update|delete","id":...,...}.
+// Правка дня — это одна дозапись в журнал; compact() сворачивает журнал
+// обратно в снимок. Не зависит от виджетов — ошибки возвращаются текстом,
+// показывать их (или нет) решает вызывающий.
+class DayStore
+{
+public:
+    enum class JournalOp { Add, Update, Delete };
+
+    // Одна правка для журнала
+    struct JournalRecord {
+        JournalOp op;
+        Event event;
+    };
+
+    // Подпись данных дня: время изменения (мс) и размер снимка и журнала.
+    // Нули — файла нет. По подписи кэши понимают, что день не менялся.
+    struct Signature {
+        qint64 jsonMtime = 0;
+        qint64 jsonSize = 0;
+        qint64 journalMtime = 0;
+        qint64 journalSize = 0;
+
+        bool exists() const { return jsonMtime != 0 || journalMtime != 0; }
+        bool operator==(const Signature &o) const {
+            return jsonMtime == o.jsonMtime && jsonSize == o.jsonSize
+                   && journalMtime == o.journalMtime && journalSize == o.journalSize;
+        }
+        bool operator!=(const Signature &o) const { return !(*this == o); }
+    };
+
+    explicit DayStore(const QString &dataDir = defaultDataDir());
+
+    // Локальная ./data рядом с исполняемым файлом (папка создаётся при вызове)
+    static QString defaultDataDir();
+
+    QString dataDir() const { return m_dataDir; }
+    QString filePathForDate(const QDate &date) const;
+    QString journalPathForDate(const QDate &date) const;
+
+    // Подпись снимается ДО чтения файлов: если день поменяется во время
+    // чтения, следующая проверка увидит расхождение
+    Signature signature(const QDate &date) const;
+
+    // Загрузка дня: снимок + журнал. Отсутствующие файлы — не ошибка (пустой день).
+    // Событиям без id выдаётся новый id; если такие были — generatedIds = true,
+    // и день стоит пересохранить.
+    bool load(const QDate &date, QVector<Event> &events,
+              bool *generatedIds = nullptr, QString *errorString = nullptr) const;
+
+    // Загрузка только нужных полей (для анализа — EventScanner::TimeAndTag).
+    // id для событий без него не выдаются; записи журнала — целиком.
+    bool loadFields(const QDate &date, QVector<Event> &events, EventScanner::Fields fields,
+                    QString *errorString = nullptr) const;
+
+    // Полная атомарная перезапись снимка через QSaveFile (журнал удаляется)
+    bool save(const QDate &date, const QVector<Event> &events,
+              QString *errorString = nullptr) const;
+
+    // Чтение, правка и перезапись дня: если между чтением и записью день
+    // изменили из другого потока (дозапись журнала из окна), всё повторяется
+    // заново, поэтому правки не теряются, а edit может быть вызван несколько
+    // раз (каждый раз с заново прочитанными событиями). Блокировка журналов
+    // держится только на чтении и подмене файла — дни правятся параллельно.
+    // События без id получают id. edit вернул false — день не записывается,
+    // если только снимку не пришлось выдать id: тогда он перезаписывается
+    // (как и в load()), иначе id менялись бы при каждом чтении.
+    bool modify(const QDate &date, const std::function<bool(QVector<Event> &)> &edit,
+                QString *errorString = nullptr) const;
+
+    // Дозапись одной правки в журнал дня. Для Delete важен только e.id.
+    bool appendToJournal(const QDate &date, JournalOp op, const Event &e,
+                         QString *errorString = nullptr) const;
+    // Несколько правок одной записью в файл (порядок сохраняется)
+    bool appendToJournal(const QDate &date, const QVector<JournalRecord> &records,
+                         QString *errorString = nullptr) const;
+
+    // Журнал разросся настолько, что его стоит свернуть в снимок
+    bool needsCompaction(const QDate &date) const;
+
+    // Сворачивание журнала в снимок. Безопасно вызывать из фонового потока.
+    bool compact(const QDate &date, QString *errorString = nullptr) const;
+
+private:
+    QString m_dataDir;
+
+    bool writeSnapshot(const QString &filename, const QVector<Event> &events,
+                       QString *errorString) const;
+};
+
+Q_DECLARE_METATYPE(DayStore::Signature)
+
+#endif // DAYSTORE_H
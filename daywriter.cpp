@@ -0,0 +1,127 @@
+#include "daywriter.h"
+#include "trace.h"
+
+#include <QMutexLocker>
+#include <QThread>
+
+namespace {
+
+// Пауза в правках, после которой накопленное уходит на диск
+const qint64 kDebounceMs = 150;
+// При непрерывных правках пишем не реже, чем раз в столько
+const qint64 kMaxDelayMs = 1000;
+
+} // namespace
+
+DayWriter::DayWriter(const DayStore &store, QObject *parent)
+    : QObject(parent)
+    , m_store(store)
+{
+    qRegisterMetaType<DayStore::Signature>("DayStore::Signature");
+    m_lastEnqueue.start();
+
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->setObjectName(QStringLiteral("DayWriter"));
+    m_thread->start();
+}
+
+DayWriter::~DayWriter()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_wake.wakeAll();
+    }
+    m_thread->wait();   // run() выходит, только разобрав очередь
+    delete m_thread;
+}
+
+void DayWriter::enqueueJournal(const QDate &date, DayStore::JournalOp op, const Event &e)
+{
+    QMutexLocker locker(&m_mutex);
+    Pending &pending = m_pending[date];
+    pending.journal.append({ op, e });
+    ++pending.ops;
+    m_lastEnqueue.restart();
+    m_wake.wakeAll();
+}
+
+void DayWriter::enqueueSave(const QDate &date, const QVector<Event> &events)
+{
+    QMutexLocker locker(&m_mutex);
+    Pending &pending = m_pending[date];
+    pending.saveSnapshot = true;
+    pending.snapshot = events;
+    pending.journal.clear();     // снимок уже содержит эти правки
+    ++pending.ops;
+    m_lastEnqueue.restart();
+    m_wake.wakeAll();
+}
+
+void DayWriter::flush()
+{
+    QMutexLocker locker(&m_mutex);
+    ++m_flushWaiters;
+    m_wake.wakeAll();
+    while (!m_pending.isEmpty() || m_writing)
+        m_idle.wait(&m_mutex);
+    --m_flushWaiters;
+}
+
+void DayWriter::run()
+{
+    QMutexLocker locker(&m_mutex);
+    for (;;) {
+        while (m_pending.isEmpty() && !m_stopping)
+            m_wake.wait(&m_mutex);
+        if (m_pending.isEmpty())
+            break;  // остановка с пустой очередью
+
+        // Ждём паузы в правках, чтобы записать их одной пачкой
+        QElapsedTimer batchAge;
+        batchAge.start();
+        while (!m_stopping && m_flushWaiters == 0) {
+            const qint64 quiet = m_lastEnqueue.elapsed();
+            if (quiet >= kDebounceMs || batchAge.elapsed() >= kMaxDelayMs)
+                break;
+            m_wake.wait(&m_mutex, ulong(kDebounceMs - quiet));
+        }
+
+        QMap<QDate, Pending> batch;
+        batch.swap(m_pending);
+        m_writing = true;
+
+        locker.unlock();
+        writeBatch(batch);
+        locker.relock();
+
+        m_writing = false;
+        m_idle.wakeAll();
+    }
+    m_idle.wakeAll();
+}
+
+void DayWriter::writeBatch(const QMap<QDate, Pending> &batch)
+{
+    TRACE_SCOPE("DayWriter::writeBatch");
+    for (auto it = batch.constBegin(); it != batch.constEnd(); ++it) {
+        const QDate &date = it.key();
+        const Pending &pending = it.value();
+
+        QString error;
+        if (pending.saveSnapshot && !m_store.save(date, pending.snapshot, &error)) {
+            emit failed(date, error, pending.ops, false);
+            continue;
+        }
+        if (!m_store.appendToJournal(date, pending.journal, &error)) {
+            emit failed(date, error, pending.ops, true);
+            continue;
+        }
+
+        // Сворачивание — тоже здесь, GUI его не ждёт
+        if (m_store.needsCompaction(date))
+            m_store.compact(date);
+
+        emit written(date, m_store.signature(date), pending.ops);
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef DAYWRITER_H
+#define DAYWRITER_H
+
+#include <QDate>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QVector>
+#include <QWaitCondition>
+#include "daystore.h"
+
+class QThread;
+
+// Отложенная запись дней в отдельном потоке. GUI только ставит правки в
+// очередь; поток ждёт паузы в правках (debounce), забирает всё накопленное
+// и пишет пачкой: по каждому дню — снимок (если просили) и все правки
+// журнала одной дозаписью, затем при необходимости сворачивает журнал.
+//
+// Результаты приходят сигналами (в потоке получателя). ops — сколько
+// поставленных в очередь операций покрыла запись: день чист, когда
+// подтверждены все его операции.
+class DayWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DayWriter(const DayStore &store, QObject *parent = nullptr);
+    // Дописывает очередь и останавливает поток
+    ~DayWriter() override;
+
+    // Правка дня — в журнал
+    void enqueueJournal(const QDate &date, DayStore::JournalOp op, const Event &e);
+    // Полная перезапись дня; правки, поставленные раньше, ею покрываются
+    void enqueueSave(const QDate &date, const QVector<Event> &events);
+
+    // Блокирует до записи всего, что поставлено в очередь (для выхода)
+    void flush();
+
+signals:
+    void written(const QDate &date, const DayStore::Signature &sig, int ops);
+    // retryAsSnapshot — не удалась дозапись журнала: день стоит перезаписать целиком
+    void failed(const QDate &date, const QString &error, int ops, bool retryAsSnapshot);
+
+private:
+    struct Pending {
+        bool saveSnapshot = false;
+        QVector<Event> snapshot;
+        QVector<DayStore::JournalRecord> journal;   // правки после снимка
+        int ops = 0;
+    };
+
+    const DayStore m_store;
+    QThread *m_thread = nullptr;
+
+    QMutex m_mutex;
+    QWaitCondition m_wake;      // новая работа / flush / остановка
+    QWaitCondition m_idle;      // очередь разобрана
+    QMap<QDate, Pending> m_pending;
+    QElapsedTimer m_lastEnqueue;
+    bool m_writing = false;
+    bool m_stopping = false;
+    int m_flushWaiters = 0;
+
+    void run();
+    void writeBatch(const QMap<QDate, Pending> &batch);
+};
+
+#endif // DAYWRITER_H
@@ -0,0 +1,56 @@
+#include "downsampler.h"
+
+#include <QtMath>
+
+QVector<QPointF> Downsampler::lttb(const QVector<QPointF> &points, int threshold)
+{
+    const int n = points.size();
+    if (threshold < 3 || threshold >= n)
+        return points;
+
+    QVector<QPointF> sampled;
+    sampled.reserve(threshold);
+    sampled.append(points.first());
+
+    // Внутренние точки делятся на threshold - 2 корзины
+    const double every = double(n - 2) / (threshold - 2);
+    int a = 0;  // выбранная точка предыдущей корзины
+
+    for (int bucket = 0; bucket < threshold - 2; ++bucket) {
+        // Среднее следующей корзины — третья вершина треугольника
+        int nextFirst = int(std::floor((bucket + 1) * every)) + 1;
+        int nextLast = qMin(int(std::floor((bucket + 2) * every)) + 1, n);
+        if (nextFirst >= n)
+            nextFirst = n - 1;
+        if (nextLast <= nextFirst)
+            nextLast = nextFirst + 1;
+        double avgX = 0, avgY = 0;
+        for (int i = nextFirst; i < nextLast; ++i) {
+            avgX += points.at(i).x();
+            avgY += points.at(i).y();
+        }
+        avgX /= (nextLast - nextFirst);
+        avgY /= (nextLast - nextFirst);
+
+        const int first = int(std::floor(bucket * every)) + 1;
+        const int last = qMin(int(std::floor((bucket + 1) * every)) + 1, n - 1);
+        const QPointF &pa = points.at(a);
+
+        double maxArea = -1;
+        int chosen = first;
+        for (int i = first; i < last; ++i) {
+            const QPointF &p = points.at(i);
+            const double area = qAbs((pa.x() - avgX) * (p.y() - pa.y())
+                                     - (pa.x() - p.x()) * (avgY - pa.y()));
+            if (area > maxArea) {
+                maxArea = area;
+                chosen = i;
+            }
+        }
+        sampled.append(points.at(chosen));
+        a = chosen;
+    }
+
+    sampled.append(points.last());
+    return sampled;
+}
@@ -0,0 +1,18 @@
+#ifndef DOWNSAMPLER_H
+#define DOWNSAMPLER_H
+
+#include <QPointF>
+#include <QVector>
+
+// Прореживание рядов для графиков: точек остаётся порядка ширины области
+// в пикселях, форма ряда сохраняется. Точки должны идти по возрастанию x.
+class Downsampler
+{
+public:
+    // Largest-Triangle-Three-Buckets: из каждой корзины — точка, дающая
+    // наибольший треугольник с соседями; первая и последняя точки сохраняются.
+    // threshold < 3 или не меньше числа точек — ряд возвращается как есть.
+    static QVector<QPointF> lttb(const QVector<QPointF> &points, int threshold);
+};
+
+#endif // DOWNSAMPLER_H
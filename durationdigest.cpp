@@ -0,0 +1,152 @@
+#include "durationdigest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+// Буфер сливается, когда вырастает до стольких сжатий
+const int kBufferFactor = 5;
+
+// Функция масштаба k1: центроид может покрывать не больше единицы по k
+double scale(double q, double compression)
+{
+    return compression / (2 * kPi) * std::asin(2 * qBound(0.0, q, 1.0) - 1);
+}
+
+} // namespace
+
+DurationDigest::DurationDigest(double compression)
+    : m_compression(qMax(10.0, compression))
+{
+}
+
+void DurationDigest::add(double value, double weight)
+{
+    if (weight <= 0)
+        return;
+    if (isEmpty()) {
+        m_min = m_max = value;
+    } else {
+        m_min = qMin(m_min, value);
+        m_max = qMax(m_max, value);
+    }
+    m_weight += weight;
+    m_buffer.append({ value, weight });
+    if (m_buffer.size() >= kBufferFactor * int(m_compression))
+        compress();
+}
+
+void DurationDigest::merge(const DurationDigest &other)
+{
+    if (other.isEmpty())
+        return;
+    if (isEmpty()) {
+        m_min = other.m_min;
+        m_max = other.m_max;
+    } else {
+        m_min = qMin(m_min, other.m_min);
+        m_max = qMax(m_max, other.m_max);
+    }
+    m_weight += other.m_weight;
+    m_buffer += other.m_centroids;
+    m_buffer += other.m_buffer;
+    if (m_buffer.size() >= kBufferFactor * int(m_compression))
+        compress();
+}
+
+void DurationDigest::compress()
+{
+    if (m_buffer.isEmpty())
+        return;
+
+    QVector<Centroid> all = m_centroids + m_buffer;
+    m_buffer.clear();
+    std::sort(all.begin(), all.end(), [](const Centroid &a, const Centroid &b) {
+        return a.mean < b.mean;
+    });
+
+    // Соседи сливаются, пока центроид укладывается в единицу шкалы k
+    QVector<Centroid> merged;
+    merged.reserve(qMin(all.size(), 2 * int(m_compression)));
+    Centroid current = all.first();
+    double before = 0;      // вес левее текущего центроида
+    for (int i = 1; i < all.size(); ++i) {
+        const Centroid &next = all.at(i);
+        const double proposed = current.weight + next.weight;
+        if (scale((before + proposed) / m_weight, m_compression)
+                - scale(before / m_weight, m_compression) <= 1) {
+            current.mean += (next.mean - current.mean) * next.weight / proposed;
+            current.weight = proposed;
+        } else {
+            merged.append(current);
+            before += current.weight;
+            current = next;
+        }
+    }
+    merged.append(current);
+    m_centroids = merged;
+}
+
+double DurationDigest::quantile(double q) const
+{
+    if (isEmpty())
+        return 0;
+    if (!m_buffer.isEmpty()) {
+        DurationDigest compressed = *this;
+        compressed.compress();
+        return compressed.quantile(q);
+    }
+    if (m_centroids.size() == 1)
+        return m_centroids.first().mean;
+
+    // Центроид представляет точку в середине своего веса; между серединами —
+    // линейно, по краям — к минимуму и максимуму
+    const double target = qBound(0.0, q, 1.0) * m_weight;
+    const Centroid &first = m_centroids.first();
+    if (target < first.weight / 2)
+        return m_min + (first.mean - m_min) * target / (first.weight / 2);
+
+    double position = first.weight / 2;   // середина текущего центроида
+    for (int i = 0; i + 1 < m_centroids.size(); ++i) {
+        const Centroid &a = m_centroids.at(i);
+        const Centroid &b = m_centroids.at(i + 1);
+        const double nextPosition = position + (a.weight + b.weight) / 2;
+        if (target < nextPosition)
+            return a.mean + (b.mean - a.mean) * (target - position) / (nextPosition - position);
+        position = nextPosition;
+    }
+
+    const Centroid &last = m_centroids.last();
+    const double rest = m_weight - position;
+    return rest > 0 ? last.mean + (m_max - last.mean) * (target - position) / rest : last.mean;
+}
+
+QDataStream &operator<<(QDataStream &out, const DurationDigest &digest)
+{
+    DurationDigest compressed = digest;
+    compressed.compress();
+    out << compressed.m_compression << compressed.m_weight
+        << compressed.m_min << compressed.m_max << quint32(compressed.m_centroids.size());
+    for (const DurationDigest::Centroid &c : std::as_const(compressed.m_centroids))
+        out << c.mean << c.weight;
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, DurationDigest &digest)
+{
+    quint32 count = 0;
+    in >> digest.m_compression >> digest.m_weight >> digest.m_min >> digest.m_max >> count;
+    digest.m_buffer.clear();
+    digest.m_centroids.clear();
+    digest.m_centroids.reserve(int(qMin<quint32>(count, 1 << 16)));
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        DurationDigest::Centroid c;
+        in >> c.mean >> c.weight;
+        digest.m_centroids.append(c);
+    }
+    return in;
+}
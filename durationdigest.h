@@ -0,0 +1,54 @@
+#ifndef DURATIONDIGEST_H
+#define DURATIONDIGEST_H
+
+#include <QDataStream>
+#include <QVector>
+
+// Эскиз распределения длительностей (t-digest, «сливающий» вариант):
+// отсортированные центроиды (среднее, вес), размер которых ограничен
+// функцией масштаба k1 — у хвостов центроиды мелкие, поэтому p99 точнее
+// медианы. Память — O(compression) при любом числе значений; два эскиза
+// сливаются в один (статистика дней → статистика диапазона, частичные
+// результаты потоков → общий) с той же точностью.
+//
+// Пока значений меньше, чем позволяет сжатие, центроиды — сами значения
+// и квантили точные (типичный день). Не потокобезопасен.
+class DurationDigest
+{
+public:
+    explicit DurationDigest(double compression = 100);
+
+    void add(double value, double weight = 1);
+    void merge(const DurationDigest &other);
+
+    // Квантиль q из [0, 1] с линейной интерполяцией между центроидами;
+    // пустой эскиз — 0
+    double quantile(double q) const;
+
+    double count() const   { return m_weight; }
+    bool isEmpty() const   { return m_weight <= 0; }
+    double min() const     { return m_min; }
+    double max() const     { return m_max; }
+    int centroidCount() const { return m_centroids.size() + m_buffer.size(); }
+
+    // Сливает буфер добавленных значений с центроидами
+    void compress();
+
+    friend QDataStream &operator<<(QDataStream &out, const DurationDigest &digest);
+    friend QDataStream &operator>>(QDataStream &in, DurationDigest &digest);
+
+private:
+    struct Centroid {
+        double mean;
+        double weight;
+    };
+
+    double m_compression;
+    QVector<Centroid> m_centroids;  // по возрастанию mean
+    QVector<Centroid> m_buffer;     // ещё не слитые значения
+    double m_weight = 0;
+    double m_min = 0;
+    double m_max = 0;
+};
+
+#endif // DURATIONDIGEST_H
@@ -0,0 +1,426 @@
+#include "eventarchive.h"
+#include "daystore.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QVector>
+
+namespace {
+
+const quint32 kMagic   = 0x31415454;   // "TTA1"
+const quint32 kVersion = 1;
+
+struct ArchiveHeader
+{
+    quint32 magic;
+    quint32 version;
+    qint32  firstJulianDay;
+    quint32 dayCount;
+    quint32 rowCount;
+    quint32 tagCount;
+    quint32 stringBytes;
+    quint32 reserved;
+};
+
+struct ArchiveDay
+{
+    // Подпись источника: время изменения и размер снимка и журнала (0 — файла нет)
+    qint64  jsonMtime;
+    qint64  jsonSize;
+    qint64  journalMtime;
+    qint64  journalSize;
+    quint32 firstRow;
+    quint32 rowCount;
+};
+
+// Смещения секций файла от его начала
+struct Layout
+{
+    qint64 days, dates, tags, titles, descriptions, tagOffsets, starts, ends, strings, total;
+};
+
+Layout layoutOf(const ArchiveHeader &h)
+{
+    Layout l;
+    l.days         = sizeof(ArchiveHeader);
+    l.dates        = l.days + qint64(h.dayCount) * qint64(sizeof(ArchiveDay));
+    l.tags         = l.dates + qint64(h.rowCount) * 4;
+    l.titles       = l.tags + qint64(h.rowCount) * 4;
+    l.descriptions = l.titles + qint64(h.rowCount) * 4;
+    l.tagOffsets   = l.descriptions + qint64(h.rowCount) * 4;
+    l.starts       = l.tagOffsets + qint64(h.tagCount) * 4;
+    l.ends         = l.starts + qint64(h.rowCount) * 2;
+    l.strings      = l.ends + qint64(h.rowCount) * 2;
+    l.total        = l.strings + h.stringBytes;
+    return l;
+}
+
+const ArchiveHeader &headerOf(const uchar *data)
+{
+    return *reinterpret_cast<const ArchiveHeader *>(data);
+}
+
+// Содержимое согласовано с заголовком: строки дней — в пределах колонок,
+// даты — в месяце, время — в сутках, id тегов — в словаре, смещения — в блоке
+// строк, а блок кончается '\0'. Проверяется один раз при отображении, чтобы
+// проходы по колонкам не сверяли индексы и не читали за границей битого файла.
+bool validContents(const uchar *data, const ArchiveHeader &h)
+{
+    const Layout l = layoutOf(h);
+    const ArchiveDay *days = reinterpret_cast<const ArchiveDay *>(data + l.days);
+    for (quint32 i = 0; i < h.dayCount; ++i) {
+        if (quint64(days[i].firstRow) + days[i].rowCount > h.rowCount)
+            return false;
+    }
+
+    // Любое смещение меньше stringBytes тогда найдёт свой '\0' внутри блока
+    if (h.stringBytes > 0 && data[l.strings + h.stringBytes - 1] != '\0')
+        return false;
+
+    const quint32 *tagOffsets = reinterpret_cast<const quint32 *>(data + l.tagOffsets);
+    for (quint32 t = 0; t < h.tagCount; ++t) {
+        if (tagOffsets[t] >= h.stringBytes)
+            return false;
+    }
+
+    const qint32  *dates        = reinterpret_cast<const qint32 *>(data + l.dates);
+    const quint32 *tags         = reinterpret_cast<const quint32 *>(data + l.tags);
+    const quint32 *titles       = reinterpret_cast<const quint32 *>(data + l.titles);
+    const quint32 *descriptions = reinterpret_cast<const quint32 *>(data + l.descriptions);
+    const qint16  *starts       = reinterpret_cast<const qint16 *>(data + l.starts);
+    const qint16  *ends         = reinterpret_cast<const qint16 *>(data + l.ends);
+    const qint64 firstDay = h.firstJulianDay;
+    for (quint32 i = 0; i < h.rowCount; ++i) {
+        if (dates[i] < firstDay || dates[i] >= firstDay + qint64(h.dayCount)
+            || tags[i] >= h.tagCount
+            || titles[i] >= h.stringBytes || descriptions[i] >= h.stringBytes
+            || starts[i] < -1 || starts[i] >= 24 * 60
+            || ends[i] < -1 || ends[i] >= 24 * 60)
+            return false;
+    }
+    return true;
+}
+
+bool hasSource(const ArchiveDay &d)
+{
+    return d.jsonMtime != 0 || d.journalMtime != 0;
+}
+
+bool sameSource(const ArchiveDay &a, const ArchiveDay &b)
+{
+    return a.jsonMtime == b.jsonMtime && a.jsonSize == b.jsonSize
+           && a.journalMtime == b.journalMtime && a.journalSize == b.journalSize;
+}
+
+// Текущие подписи файлов дней месяца (см. DayStore::signature)
+QVector<ArchiveDay> currentSources(const DayStore &store, const QDate &month)
+{
+    QVector<ArchiveDay> days(month.daysInMonth());
+    for (int i = 0; i < days.size(); ++i) {
+        const DayStore::Signature sig = store.signature(month.addDays(i));
+        ArchiveDay &d = days[i];
+        d.jsonMtime    = sig.jsonMtime;
+        d.jsonSize     = sig.jsonSize;
+        d.journalMtime = sig.journalMtime;
+        d.journalSize  = sig.journalSize;
+        d.firstRow = d.rowCount = 0;
+    }
+    return days;
+}
+
+qint16 minutesOf(const QTime &t)
+{
+    return t.isValid() ? qint16(t.hour() * 60 + t.minute()) : qint16(-1);
+}
+
+template <typename T>
+void appendColumn(QByteArray &out, const QVector<T> &column)
+{
+    out.append(reinterpret_cast<const char *>(column.constData()), int(column.size() * sizeof(T)));
+}
+
+bool buildArchive(const DayStore &store, const QDate &month, QVector<ArchiveDay> days,
+                  const QString &path, QString *errorString)
+{
+    QVector<qint32>  dates;
+    QVector<quint32> tags, titles, descriptions, tagOffsets;
+    QVector<qint16>  starts, ends;
+    QHash<QString, quint32> tagIds;
+
+    // Строки складываются в общий блок без повторов
+    QByteArray strings;
+    QHash<QString, quint32> stringOffsets;
+    auto intern = [&](const QString &s) -> quint32 {
+        const auto it = stringOffsets.constFind(s);
+        if (it != stringOffsets.constEnd())
+            return it.value();
+        const quint32 offset = quint32(strings.size());
+        strings += s.toUtf8();
+        strings += '\0';
+        stringOffsets.insert(s, offset);
+        return offset;
+    };
+
+    QVector<Event> events;
+    for (int i = 0; i < days.size(); ++i) {
+        ArchiveDay &d = days[i];
+        d.firstRow = quint32(dates.size());
+        if (!hasSource(d))
+            continue;
+
+        // Битый файл дня в архив не попадает (как и при разборе JSON),
+        // но подпись сохраняется — пересборка будет только после правки файла
+        const QDate date = month.addDays(i);
+        if (!store.load(date, events))
+            continue;
+
+        for (const Event &e : events) {
+            auto tagIt = tagIds.constFind(e.tag);
+            if (tagIt == tagIds.constEnd()) {
+                tagIt = tagIds.insert(e.tag, quint32(tagOffsets.size()));
+                tagOffsets.append(intern(e.tag));
+            }
+
+            dates.append(qint32(date.toJulianDay()));
+            tags.append(tagIt.value());
+            titles.append(intern(e.title));
+            descriptions.append(intern(e.description));
+            starts.append(minutesOf(e.start));
+            ends.append(minutesOf(e.end));
+        }
+        d.rowCount = quint32(events.size());
+    }
+
+    ArchiveHeader h{};
+    h.magic          = kMagic;
+    h.version        = kVersion;
+    h.firstJulianDay = qint32(month.toJulianDay());
+    h.dayCount       = quint32(days.size());
+    h.rowCount       = quint32(dates.size());
+    h.tagCount       = quint32(tagOffsets.size());
+    h.stringBytes    = quint32(strings.size());
+
+    QByteArray out;
+    out.reserve(int(layoutOf(h).total));
+    out.append(reinterpret_cast<const char *>(&h), int(sizeof(h)));
+    appendColumn(out, days);
+    appendColumn(out, dates);
+    appendColumn(out, tags);
+    appendColumn(out, titles);
+    appendColumn(out, descriptions);
+    appendColumn(out, tagOffsets);
+    appendColumn(out, starts);
+    appendColumn(out, ends);
+    out.append(strings);
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)
+        || file.write(out) != out.size()
+        || !file.commit()) {
+        if (errorString)
+            *errorString = "Не удалось записать архив: " + path + "\n" + file.errorString();
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+EventArchive::EventArchive()
+{
+}
+
+EventArchive::~EventArchive()
+{
+    close();
+}
+
+QString EventArchive::archivePath(const QString &dataDir, const QDate &month)
+{
+    return dataDir + "/archive/" + month.toString("yyyy-MM") + ".ttar";
+}
+
+bool EventArchive::openFresh(const QString &dataDir, const QDate &month, QString *errorString)
+{
+    close();
+    const QDate first(month.year(), month.month(), 1);
+
+    // Нет каталога — нет и данных; ничего не создаём
+    if (!QFileInfo(dataDir).isDir()) {
+        m_month = first;
+        return true;
+    }
+
+    const DayStore store(dataDir);
+    const QVector<ArchiveDay> sources = currentSources(store, first);
+    const QString path = archivePath(dataDir, first);
+
+    bool anyData = false;
+    for (const ArchiveDay &d : sources)
+        anyData = anyData || hasSource(d);
+    if (!anyData) {
+        QFile::remove(path);   // месяц опустел — старый архив больше не нужен
+        m_month = first;
+        return true;
+    }
+
+    if (map(path, first)) {
+        const ArchiveDay *days = reinterpret_cast<const ArchiveDay *>(m_data + sizeof(ArchiveHeader));
+        bool fresh = true;
+        for (int i = 0; i < sources.size() && fresh; ++i)
+            fresh = sameSource(days[i], sources[i]);
+        if (fresh)
+            return true;
+        close();
+    }
+
+    if (!buildArchive(store, first, sources, path, errorString))
+        return false;
+    if (!map(path, first)) {
+        if (errorString)
+            *errorString = "Не удалось отобразить архив в память: " + path;
+        return false;
+    }
+    return true;
+}
+
+bool EventArchive::openExisting(const QString &dataDir, const QDate &month)
+{
+    close();
+    const QDate first(month.year(), month.month(), 1);
+    return map(archivePath(dataDir, first), first);
+}
+
+void EventArchive::close()
+{
+    if (m_data)
+        m_file.unmap(const_cast<uchar *>(m_data));
+    if (m_file.isOpen())
+        m_file.close();
+    m_data = nullptr;
+    m_size = 0;
+    m_month = QDate();
+}
+
+bool EventArchive::map(const QString &path, const QDate &month)
+{
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly))
+        return false;
+
+    m_size = m_file.size();
+    if (m_size < qint64(sizeof(ArchiveHeader))) {
+        close();
+        return false;
+    }
+
+    m_data = m_file.map(0, m_size);
+    if (!m_data) {
+        close();
+        return false;
+    }
+
+    const ArchiveHeader &h = headerOf(m_data);
+    if (h.magic != kMagic || h.version != kVersion
+        || h.firstJulianDay != qint32(month.toJulianDay())
+        || h.dayCount != quint32(month.daysInMonth())
+        || layoutOf(h).total != m_size
+        || !validContents(m_data, h)) {
+        close();
+        return false;
+    }
+
+    m_month = month;
+    return true;
+}
+
+bool EventArchive::hasDay(const QDate &date) const
+{
+    if (!m_data)
+        return false;
+    const qint64 index = m_month.daysTo(date);
+    if (index < 0 || index >= qint64(headerOf(m_data).dayCount))
+        return false;
+    return hasSource(reinterpret_cast<const ArchiveDay *>(m_data + sizeof(ArchiveHeader))[index]);
+}
+
+bool EventArchive::dayMatches(const QDate &date, const DayStore::Signature &sig) const
+{
+    if (!hasDay(date))
+        return false;
+    const ArchiveDay &d = reinterpret_cast<const ArchiveDay *>(m_data + sizeof(ArchiveHeader))[m_month.daysTo(date)];
+    return d.jsonMtime == sig.jsonMtime && d.jsonSize == sig.jsonSize
+           && d.journalMtime == sig.journalMtime && d.journalSize == sig.journalSize;
+}
+
+int EventArchive::firstRowOfDay(const QDate &date) const
+{
+    if (!hasDay(date))
+        return 0;
+    return int(reinterpret_cast<const ArchiveDay *>(m_data + sizeof(ArchiveHeader))[m_month.daysTo(date)].firstRow);
+}
+
+int EventArchive::rowCountOfDay(const QDate &date) const
+{
+    if (!hasDay(date))
+        return 0;
+    return int(reinterpret_cast<const ArchiveDay *>(m_data + sizeof(ArchiveHeader))[m_month.daysTo(date)].rowCount);
+}
+
+int EventArchive::rowCount() const
+{
+    return m_data ? int(headerOf(m_data).rowCount) : 0;
+}
+
+const qint32 *EventArchive::dateColumn() const
+{
+    return m_data ? reinterpret_cast<const qint32 *>(m_data + layoutOf(headerOf(m_data)).dates) : nullptr;
+}
+
+const qint16 *EventArchive::startColumn() const
+{
+    return m_data ? reinterpret_cast<const qint16 *>(m_data + layoutOf(headerOf(m_data)).starts) : nullptr;
+}
+
+const qint16 *EventArchive::endColumn() const
+{
+    return m_data ? reinterpret_cast<const qint16 *>(m_data + layoutOf(headerOf(m_data)).ends) : nullptr;
+}
+
+const quint32 *EventArchive::tagColumn() const
+{
+    return m_data ? reinterpret_cast<const quint32 *>(m_data + layoutOf(headerOf(m_data)).tags) : nullptr;
+}
+
+const quint32 *EventArchive::titleColumn() const
+{
+    return m_data ? reinterpret_cast<const quint32 *>(m_data + layoutOf(headerOf(m_data)).titles) : nullptr;
+}
+
+const quint32 *EventArchive::descriptionColumn() const
+{
+    return m_data ? reinterpret_cast<const quint32 *>(m_data + layoutOf(headerOf(m_data)).descriptions) : nullptr;
+}
+
+int EventArchive::tagCount() const
+{
+    return m_data ? int(headerOf(m_data).tagCount) : 0;
+}
+
+QString EventArchive::tag(quint32 tagId) const
+{
+    if (!m_data || tagId >= headerOf(m_data).tagCount)
+        return QString();
+    const quint32 *offsets = reinterpret_cast<const quint32 *>(m_data + layoutOf(headerOf(m_data)).tagOffsets);
+    return string(offsets[tagId]);
+}
+
+QString EventArchive::string(quint32 offset) const
+{
+    if (!m_data || offset >= headerOf(m_data).stringBytes)
+        return QString();
+    return QString::fromUtf8(reinterpret_cast<const char *>(m_data + layoutOf(headerOf(m_data)).strings + offset));
+}
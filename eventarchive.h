@@ -0,0 +1,69 @@
+#ifndef EVENTARCHIVE_H
+#define EVENTARCHIVE_H
+
+#include <QDate>
+#include <QFile>
+#include <QString>
+#include "daystore.h"
+
+// Бинарный колоночный архив событий за месяц: dataDir/archive/yyyy-MM.ttar.
+// Файлы дней (JSON + журнал) остаются редактируемым источником; архив —
+// производный кэш для анализа, отображается в память через QFile::map
+// и пересобирается помесячно, когда меняется хоть один файл дня месяца.
+//
+// Раскладка файла (нативный порядок байт):
+//   Header | Day[dayCount] | date i32 | tag u32 | title u32 | description u32
+//   | tagOffset u32[tagCount] | start i16 | end i16 | строки UTF-8 (с '\0')
+// Колонки имеют длину rowCount; строки отсортированы по дате, поэтому
+// события одного дня лежат подряд: [Day::firstRow, firstRow + rowCount).
+// При отображении проверяются заголовок и все индексы и смещения колонок;
+// несогласованный (битый) файл не открывается, openFresh() его пересобирает.
+class EventArchive
+{
+public:
+    EventArchive();
+    ~EventArchive();
+
+    EventArchive(const EventArchive &) = delete;
+    EventArchive &operator=(const EventArchive &) = delete;
+
+    static QString archivePath(const QString &dataDir, const QDate &month);
+
+    // Открывает архив месяца (month — любой день месяца). Если архива нет
+    // или он устарел относительно файлов дней — пересобирает его.
+    // Месяц без данных файла не получает: архив открыт, но пуст.
+    bool openFresh(const QString &dataDir, const QDate &month, QString *errorString = nullptr);
+    // Открывает уже записанный архив месяца как есть: без сверки с файлами
+    // дней и без пересборки. Актуальность дня — dayMatches()
+    bool openExisting(const QString &dataDir, const QDate &month);
+    void close();
+
+    // Есть ли в источнике данные этого дня (снимок или журнал)
+    bool hasDay(const QDate &date) const;
+    // Строки дня собраны из файлов с этой подписью (то есть актуальны)
+    bool dayMatches(const QDate &date, const DayStore::Signature &sig) const;
+    int firstRowOfDay(const QDate &date) const;
+    int rowCountOfDay(const QDate &date) const;
+
+    int rowCount() const;
+    const qint32  *dateColumn() const;        // юлианский день
+    const qint16  *startColumn() const;       // минуты от полуночи, -1 — нет времени
+    const qint16  *endColumn() const;
+    const quint32 *tagColumn() const;         // id в словаре тегов
+    const quint32 *titleColumn() const;       // смещения в блоке строк
+    const quint32 *descriptionColumn() const;
+
+    int tagCount() const;
+    QString tag(quint32 tagId) const;
+    QString string(quint32 offset) const;
+
+private:
+    QFile m_file;
+    const uchar *m_data = nullptr;
+    qint64 m_size = 0;
+    QDate m_month;      // первый день месяца
+
+    bool map(const QString &path, const QDate &month);
+};
+
+#endif // EVENTARCHIVE_H
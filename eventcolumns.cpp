@@ -0,0 +1,92 @@
+#include "eventcolumns.h"
+
+quint32 TagDictionary::intern(const QString &tag)
+{
+    const auto it = m_ids.constFind(tag);
+    if (it != m_ids.constEnd())
+        return it.value();
+    const quint32 id = quint32(m_tags.size());
+    m_tags.append(tag);
+    m_ids.insert(tag, id);
+    return id;
+}
+
+EventColumns::EventColumns(const QVector<Event> &events, TagDictionary &tags)
+{
+    const int n = events.size();
+    m_ids.reserve(n);
+    m_starts.reserve(n);
+    m_ends.reserve(n);
+    m_tags.reserve(n);
+    m_titles.reserve(n);
+    m_descriptions.reserve(n);
+
+    for (const Event &e : events) {
+        m_ids.append(e.id);
+        m_starts.append(minutesOf(e.start));
+        m_ends.append(minutesOf(e.end));
+        m_tags.append(tags.intern(e.tag));
+        m_titles.append(appendString(e.title));
+        m_descriptions.append(appendString(e.description));
+    }
+    m_strings.squeeze();
+}
+
+qint16 EventColumns::minutesOf(const QTime &t)
+{
+    return t.isValid() ? qint16(t.hour() * 60 + t.minute()) : qint16(-1);
+}
+
+quint32 EventColumns::appendString(const QString &s)
+{
+    const quint32 offset = quint32(m_strings.size());
+    m_strings += s.toUtf8();
+    return offset;
+}
+
+QString EventColumns::stringAt(quint32 offset, quint32 end) const
+{
+    return QString::fromUtf8(m_strings.constData() + offset, int(end - offset));
+}
+
+QString EventColumns::title(int row) const
+{
+    return stringAt(m_titles.at(row), m_descriptions.at(row));
+}
+
+QString EventColumns::description(int row) const
+{
+    const quint32 end = row + 1 < size() ? m_titles.at(row + 1) : quint32(m_strings.size());
+    return stringAt(m_descriptions.at(row), end);
+}
+
+Event EventColumns::eventAt(int row, const TagDictionary &tags) const
+{
+    Event e;
+    e.id = m_ids.at(row);
+    e.title = title(row);
+    if (m_starts.at(row) >= 0)
+        e.start = QTime(m_starts.at(row) / 60, m_starts.at(row) % 60);
+    if (m_ends.at(row) >= 0)
+        e.end = QTime(m_ends.at(row) / 60, m_ends.at(row) % 60);
+    e.tag = tags.tag(m_tags.at(row));
+    e.description = description(row);
+    return e;
+}
+
+QVector<Event> EventColumns::toEvents(const TagDictionary &tags) const
+{
+    QVector<Event> events;
+    events.reserve(size());
+    for (int i = 0; i < size(); ++i)
+        events.append(eventAt(i, tags));
+    return events;
+}
+
+qint64 EventColumns::bytes() const
+{
+    return qint64(m_ids.capacity()) * qint64(sizeof(QUuid))
+           + qint64(m_starts.capacity() + m_ends.capacity()) * 2
+           + qint64(m_tags.capacity() + m_titles.capacity() + m_descriptions.capacity()) * 4
+           + m_strings.capacity();
+}
@@ -0,0 +1,73 @@
+#ifndef EVENTCOLUMNS_H
+#define EVENTCOLUMNS_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QUuid>
+#include <QVector>
+#include "event.h"
+
+// Словарь тегов: каждый различный тег хранится один раз, события ссылаются на id.
+class TagDictionary
+{
+public:
+    quint32 intern(const QString &tag);
+    QString tag(quint32 id) const { return m_tags.value(int(id)); }
+    int size() const { return m_tags.size(); }
+
+private:
+    QHash<QString, quint32> m_ids;
+    QVector<QString> m_tags;
+};
+
+// Компактное представление событий дня «структурой массивов»: время — минуты
+// от полуночи (qint16, -1 — не задано), тег — id из TagDictionary, название
+// и описание — смещения в общем UTF-8 блоке строк. Порядок строк — как в
+// исходном векторе. Event остаётся типом для редактирования и ввода-вывода.
+//
+// Класс — только форма хранения дней в DayCache; своих проходов (сумм,
+// сортировки, пересечений) у него нет. Суммы и фильтры по целым колонкам
+// считаются по помесячным архивам (EventArchive: TagRollupCache, EventQuery),
+// пересечения внутри дня — IntervalIndex, сортировка — EventListModel.
+class EventColumns
+{
+public:
+    EventColumns() = default;
+    EventColumns(const QVector<Event> &events, TagDictionary &tags);
+
+    QVector<Event> toEvents(const TagDictionary &tags) const;
+    Event eventAt(int row, const TagDictionary &tags) const;
+
+    int size() const { return m_ids.size(); }
+    bool isEmpty() const { return m_ids.isEmpty(); }
+
+    const QUuid   *ids() const    { return m_ids.constData(); }
+    const qint16  *starts() const { return m_starts.constData(); }
+    const qint16  *ends() const   { return m_ends.constData(); }
+    const quint32 *tagIds() const { return m_tags.constData(); }
+    QString title(int row) const;
+    QString description(int row) const;
+
+    // Оценка занимаемой памяти
+    qint64 bytes() const;
+
+    static qint16 minutesOf(const QTime &t);
+
+private:
+    QVector<QUuid>   m_ids;
+    QVector<qint16>  m_starts;
+    QVector<qint16>  m_ends;
+    QVector<quint32> m_tags;
+    QVector<quint32> m_titles;          // смещения в m_strings
+    QVector<quint32> m_descriptions;
+    // UTF-8 без разделителей: строки идут подряд (название, описание, название
+    // следующей строки, ...), поэтому конец строки — начало следующей. Так
+    // сохраняются и строки с U+0000 внутри
+    QByteArray       m_strings;
+
+    quint32 appendString(const QString &s);
+    QString stringAt(quint32 offset, quint32 end) const;
+};
+
+#endif // EVENTCOLUMNS_H
@@ -53,6 +53,11 @@ EventDialog::EventDialog(QWidget *parent)
 
     connect(ui->buttonBox, &QDialogButtonBox::accepted, this, &QDialog::accept);
     connect(ui->buttonBox, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    // Наложения проверяются сразу при правке времени
+    connect(ui->timeEditStart, &QTimeEdit::timeChanged, this, [this]() { updateConflicts(); });
+    connect(ui->timeEditEnd,   &QTimeEdit::timeChanged, this, [this]() { updateConflicts(); });
+    connect(ui->pushButtonAutoAdjust, &QPushButton::clicked, this, &EventDialog::autoAdjust);
 }
 
 EventDialog::~EventDialog() {
@@ -98,6 +103,62 @@ void EventDialog::rebuildTagList()
     }
 }
 
+void EventDialog::setDayEvents(const QVector<Event> &events, const QUuid &editedId)
+{
+    m_dayEvents = events;
+    m_dayIndex = IntervalIndex(events);
+    m_editedId = editedId;
+    updateConflicts();
+}
+
+QVector<int> EventDialog::updateConflicts()
+{
+    const QTime start = ui->timeEditStart->time();
+    const QTime end   = ui->timeEditEnd->time();
+    const QVector<int> conflicts = m_dayIndex.overlapping(start, end, m_editedId);
+
+    ui->labelConflicts->setVisible(!conflicts.isEmpty());
+    ui->pushButtonAutoAdjust->setVisible(!conflicts.isEmpty());
+    if (conflicts.isEmpty())
+        return conflicts;
+
+    // Первые несколько помех поимённо; точные дубли отмечаем отдельно
+    const int kShown = 3;
+    QStringList lines;
+    for (int i = 0; i < conflicts.size() && i < kShown; ++i) {
+        const Event &e = m_dayEvents.at(conflicts.at(i));
+        QString line = tr("«%1» %2–%3").arg(e.title, e.start.toString("HH:mm"), e.end.toString("HH:mm"));
+        if (e.start == start && e.end == end)
+            line += tr(" (дубликат)");
+        lines << line;
+    }
+    QString text = tr("Пересекается с: %1").arg(lines.join(QStringLiteral(", ")));
+    if (conflicts.size() > kShown)
+        text += tr(" и ещё %1").arg(conflicts.size() - kShown);
+    ui->labelConflicts->setText(text);
+    return conflicts;
+}
+
+void EventDialog::autoAdjust()
+{
+    const QTime start = ui->timeEditStart->time();
+    const QTime end   = ui->timeEditEnd->time();
+    int length = start.secsTo(end) / 60;
+    if (length <= 0)
+        length += 24 * 60; // через полночь
+
+    const int freeStart = m_dayIndex.nextFreeStart(start.hour() * 60 + start.minute(), length, m_editedId);
+    if (freeStart < 0) {
+        QMessageBox::information(this, tr("Нет свободного времени"),
+                                 tr("До конца дня нет свободного промежутка такой длительности."));
+        return;
+    }
+
+    const QTime newStart = QTime(0, 0).addSecs(freeStart * 60);
+    ui->timeEditStart->setTime(newStart);
+    ui->timeEditEnd->setTime(newStart.addSecs(length * 60));
+}
+
 // --- Геттеры ---
 QString EventDialog::getTitle() const {
     return ui->lineEditTitle->text();
@@ -177,6 +238,16 @@ void EventDialog::accept()
     // end < start трактуется как «через полночь» — это ОК, ничего не делаем.
     // end > start — обычный случай — тоже ОК.
 
+    // 4) Наложения не запрещаем (бывает и так), но сохраняем только после подтверждения
+    if (!updateConflicts().isEmpty()) {
+        const auto answer = QMessageBox::question(
+            this, tr("Наложение событий"),
+            tr("Событие пересекается с другими событиями дня — в анализе это время "
+               "посчитается дважды. Сохранить всё равно?"));
+        if (answer != QMessageBox::Yes)
+            return;
+    }
+
     // Если все проверки прошли — закрываем диалог как Accepted
     QDialog::accept();
 }
@@ -5,6 +5,10 @@
 #include <QTime>
 #include <QString>
 #include <QStringList>
+#include <QUuid>
+#include <QVector>
+#include "event.h"
+#include "intervalindex.h"
 
 namespace Ui {
 class EventDialog;
@@ -32,6 +36,9 @@ public:
     void setTag(const QString &);
     void setDescription(const QString &);
 
+    // События дня для проверки наложений; editedId — само редактируемое событие
+    void setDayEvents(const QVector<Event> &events, const QUuid &editedId = QUuid());
+
     // Управление «пасхальным режимом»: при false — extraTags отключены
     void setEasterEnabled(bool on);
     bool  isEasterEnabled() const { return m_easterEnabled; }
@@ -48,6 +55,16 @@ private:
 
     // Пересобирает список тегов в комбобоксе с учётом m_easterEnabled
     void rebuildTagList();
+
+    // Наложения на другие события дня (индекс строится один раз на диалог)
+    QVector<Event> m_dayEvents;
+    IntervalIndex m_dayIndex;
+    QUuid m_editedId;
+
+    // Пересчёт при каждом изменении времени; возвращает номера событий-помех
+    QVector<int> updateConflicts();
+    // Сдвиг на ближайшее свободное время с той же длительностью
+    void autoAdjust();
 };
 
 #endif // EVENTDIALOG_H
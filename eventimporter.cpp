@@ -0,0 +1,578 @@
+#include "eventimporter.h"
+#include "trace.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QIODevice>
+#include <QSet>
+#include <QtConcurrent>
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+namespace {
+
+// Пространство имён для id из нестандартных UID: повторный импорт того же
+// календаря даёт те же id — и те же дубликаты
+const QUuid kImportNamespace(0x6b1f3c2a, 0x8d4e, 0x4f60, 0x9a17, 0x2c, 0x5e, 0x71, 0x0b, 0x93, 0xd8, 0x44, 0xf6);
+
+struct DayMerge {
+    int added = 0;
+    int duplicates = 0;
+    bool written = false;
+    bool ok = true;
+    QString error;
+};
+
+// --- Разбор значений без QDate/QTime::fromString (на миллионах строк заметно) ---
+
+int digits(const char *p, int count)
+{
+    int value = 0;
+    for (int i = 0; i < count; ++i) {
+        if (p[i] < '0' || p[i] > '9')
+            return -1;
+        value = value * 10 + (p[i] - '0');
+    }
+    return value;
+}
+
+// yyyy-MM-dd, dd.MM.yyyy или yyyyMMdd
+QDate parseDate(const QByteArray &text)
+{
+    const char *p = text.constData();
+    if (text.size() >= 10 && p[4] == '-' && p[7] == '-')
+        return QDate(digits(p, 4), digits(p + 5, 2), digits(p + 8, 2));
+    if (text.size() >= 10 && p[2] == '.' && p[5] == '.')
+        return QDate(digits(p + 6, 4), digits(p + 3, 2), digits(p, 2));
+    if (text.size() >= 8)
+        return QDate(digits(p, 4), digits(p + 4, 2), digits(p + 6, 2));
+    return QDate();
+}
+
+// H:mm, HH:mm, HH:mm:ss или HHmm[ss]
+QTime parseTime(const QByteArray &text)
+{
+    const char *p = text.constData();
+    const int n = text.size();
+    int hour = -1, minute = -1;
+    if (n >= 4 && p[1] == ':') {
+        hour = digits(p, 1);
+        minute = digits(p + 2, 2);
+    } else if (n >= 5 && p[2] == ':') {
+        hour = digits(p, 2);
+        minute = digits(p + 3, 2);
+    } else if (n >= 4) {
+        hour = digits(p, 2);
+        minute = digits(p + 2, 2);
+    }
+    return QTime(hour, minute);     // некорректные числа дают недействительное время
+}
+
+QUuid idFromText(const QByteArray &text)
+{
+    if (text.isEmpty())
+        return QUuid();
+    const QUuid id = QUuid::fromString(QLatin1String(text));
+    return id.isNull() ? QUuid::createUuidV5(kImportNamespace, text) : id;
+}
+
+QString contentKey(const Event &e)
+{
+    const QChar sep(0x1f);
+    return e.start.toString(QStringLiteral("HH:mm")) + sep + e.end.toString(QStringLiteral("HH:mm"))
+           + sep + e.title + sep + e.tag + sep + e.description;
+}
+
+// Слияние пачки событий дня с тем, что уже на диске; запись — одним снимком
+DayMerge mergeDay(const DayStore &store, const QDate &date, const QVector<Event> &incoming)
+{
+    TRACE_SCOPE("EventImporter::mergeDay");
+    DayMerge result;
+    // modify() повторяет правку, если день изменили из окна во время слияния,
+    // поэтому счётчики считаются заново на каждом вызове
+    result.ok = store.modify(date, [&incoming, &result](QVector<Event> &events) {
+        result.added = 0;
+        result.duplicates = 0;
+        QSet<QUuid> ids;
+        QSet<QString> contents;
+        ids.reserve(events.size() + incoming.size());
+        contents.reserve(events.size() + incoming.size());
+        for (const Event &e : std::as_const(events)) {
+            ids.insert(e.id);
+            contents.insert(contentKey(e));
+        }
+
+        for (Event e : incoming) {
+            const QString key = contentKey(e);
+            if ((!e.id.isNull() && ids.contains(e.id)) || contents.contains(key)) {
+                ++result.duplicates;
+                continue;
+            }
+            if (e.id.isNull())
+                e.id = QUuid::createUuid();
+            ids.insert(e.id);
+            contents.insert(key);
+            events.append(e);
+            ++result.added;
+        }
+        return result.added > 0;
+    }, &result.error);
+    result.written = result.ok && result.added > 0;
+    return result;
+}
+
+// --- CSV ---
+
+// Одна запись CSV (может занимать несколько строк, если поле в кавычках).
+// false — конец файла.
+bool readCsvRecord(QIODevice *device, char separator, QList<QByteArray> &fields)
+{
+    fields.clear();
+    QByteArray line = device->readLine();
+    if (line.isEmpty())
+        return false;
+
+    QByteArray field;
+    bool quoted = false;
+    bool wasQuoted = false;
+    int i = 0;
+    for (;;) {
+        if (i >= line.size()) {
+            if (!quoted)
+                break;
+            // Перевод строки внутри кавычек — часть поля; дочитываем запись
+            line = device->readLine();
+            i = 0;
+            if (line.isEmpty())
+                break;
+            continue;
+        }
+        const char c = line.at(i++);
+        if (quoted) {
+            if (c == '"') {
+                if (i < line.size() && line.at(i) == '"') {
+                    field += '"';
+                    ++i;
+                } else {
+                    quoted = false;
+                }
+            } else {
+                field += c;
+            }
+        } else if (c == separator) {
+            fields.append(wasQuoted ? field : field.trimmed());
+            field.clear();
+            wasQuoted = false;
+        } else if (c == '"' && field.trimmed().isEmpty()) {
+            field.clear();
+            quoted = wasQuoted = true;
+        } else if (c == '\n' || c == '\r') {
+            break;
+        } else {
+            field += c;
+        }
+    }
+    fields.append(wasQuoted ? field : field.trimmed());
+    return true;
+}
+
+enum CsvColumn { ColId, ColDate, ColStart, ColEnd, ColTitle, ColTag, ColDescription, ColCount };
+
+int columnForHeader(const QString &name)
+{
+    static const QHash<QString, int> columns = {
+        { QStringLiteral("id"), ColId }, { QStringLiteral("uid"), ColId },
+        { QStringLiteral("date"), ColDate }, { QStringLiteral("дата"), ColDate },
+        { QStringLiteral("день"), ColDate },
+        { QStringLiteral("start"), ColStart }, { QStringLiteral("начало"), ColStart },
+        { QStringLiteral("end"), ColEnd }, { QStringLiteral("конец"), ColEnd },
+        { QStringLiteral("title"), ColTitle }, { QStringLiteral("summary"), ColTitle },
+        { QStringLiteral("название"), ColTitle },
+        { QStringLiteral("tag"), ColTag }, { QStringLiteral("category"), ColTag },
+        { QStringLiteral("тег"), ColTag },
+        { QStringLiteral("description"), ColDescription },
+        { QStringLiteral("описание"), ColDescription },
+    };
+    return columns.value(name.trimmed().toLower(), -1);
+}
+
+// --- iCalendar ---
+
+QString unescapeIcsText(const QByteArray &value)
+{
+    QByteArray out;
+    out.reserve(value.size());
+    for (int i = 0; i < value.size(); ++i) {
+        const char c = value.at(i);
+        if (c == '\\' && i + 1 < value.size()) {
+            const char next = value.at(++i);
+            out += (next == 'n' || next == 'N') ? '\n' : next;
+        } else {
+            out += c;
+        }
+    }
+    return QString::fromUtf8(out);
+}
+
+// Первое значение списка через запятую (с учётом экранирования)
+QByteArray firstListItem(const QByteArray &value)
+{
+    for (int i = 0; i < value.size(); ++i) {
+        if (value.at(i) == '\\')
+            ++i;
+        else if (value.at(i) == ',')
+            return value.left(i);
+    }
+    return value;
+}
+
+// DTSTART/DTEND: дата и (если есть) время в местном поясе
+bool parseIcsDateTime(const QByteArray &params, const QByteArray &value, QDate *date, QTime *time)
+{
+    *date = parseDate(value);
+    *time = QTime();
+    if (!date->isValid())
+        return false;
+    if (params.contains("VALUE=DATE") && !params.contains("VALUE=DATE-TIME"))
+        return true;        // событие на весь день — без времени
+    const int t = value.indexOf('T');
+    if (t < 0 || value.size() < t + 5)
+        return true;        // нет времени или оно обрезано (20250101T09)
+
+    *time = parseTime(value.mid(t + 1, 4));
+    const int seconds = value.size() >= t + 7 ? digits(value.constData() + t + 5, 2) : 0;
+    if (time->isValid() && seconds > 0)
+        *time = time->addSecs(seconds);
+    if (value.endsWith('Z') && time->isValid()) {
+        const QDateTime local = QDateTime(*date, *time, Qt::UTC).toLocalTime();
+        *date = local.date();
+        *time = local.time();
+    }
+    return true;
+}
+
+// DURATION (RFC 5545): PnW, PnDTnHnMnS — в секундах; -1 — не разобрано
+qint64 parseIcsDuration(const QByteArray &value)
+{
+    qint64 seconds = 0;
+    qint64 number = 0;
+    bool any = false;
+    for (char c : value) {
+        if (c >= '0' && c <= '9') {
+            number = number * 10 + (c - '0');
+            continue;
+        }
+        switch (c) {
+        case 'W': seconds += number * 7 * 86400; any = true; break;
+        case 'D': seconds += number * 86400; any = true; break;
+        case 'H': seconds += number * 3600; any = true; break;
+        case 'M': seconds += number * 60; any = true; break;
+        case 'S': seconds += number; any = true; break;
+        case 'P': case 'T': case '+': break;
+        default: return -1;
+        }
+        number = 0;
+    }
+    return any ? seconds : -1;
+}
+
+} // namespace
+
+EventImporter::EventImporter(const DayStore &store)
+    : m_store(store)
+{
+}
+
+bool EventImporter::importFile(const QString &path, Format format, Stats *stats,
+                               QString *errorString)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorString)
+            *errorString = "Не удалось открыть файл импорта: " + path + "\n" + file.errorString();
+        return false;
+    }
+    if (format == Format::Auto) {
+        const QString suffix = QFileInfo(path).suffix().toLower();
+        format = (suffix == QLatin1String("ics") || suffix == QLatin1String("ical"))
+                     ? Format::Ics : Format::Csv;
+    }
+    return importDevice(&file, format, stats, errorString);
+}
+
+bool EventImporter::importDevice(QIODevice *device, Format format, Stats *stats,
+                                 QString *errorString)
+{
+    TRACE_SCOPE("EventImporter::import");
+    Stats local;
+    m_device = device;
+    m_pending.clear();
+    m_pendingCount = 0;
+    m_canceled.store(false);
+
+    // Без явного формата — по первой строке
+    if (format == Format::Auto)
+        format = device->peek(64).trimmed().startsWith("BEGIN:VCALENDAR") ? Format::Ics : Format::Csv;
+
+    bool ok = (format == Format::Ics) ? readIcs(local, errorString) : readCsv(local, errorString);
+    // Хвост пачки записываем и после ошибки/отмены: прочитанное не теряется
+    if (!flush(local, ok ? errorString : nullptr))
+        ok = false;
+
+    m_device = nullptr;
+    if (stats)
+        *stats = local;
+    return ok;
+}
+
+bool EventImporter::add(const QDate &date, const Event &e, Stats &stats, QString *errorString)
+{
+    m_pending[date].append(e);
+    if (++m_pendingCount < m_batchSize)
+        return true;
+    return flush(stats, errorString);
+}
+
+bool EventImporter::flush(Stats &stats, QString *errorString)
+{
+    if (m_pending.isEmpty())
+        return true;
+    TRACE_SCOPE("EventImporter::flush");
+
+    // Дни пачки независимы — разбор, слияние и запись параллельно
+    QVector<QDate> dates = m_pending.keys().toVector();
+    std::sort(dates.begin(), dates.end());
+    const DayStore store = m_store;
+    const QHash<QDate, QVector<Event>> pending = m_pending;
+    const std::function<DayMerge(const QDate &)> mergeOne = [store, pending](const QDate &date) {
+        return mergeDay(store, date, pending.value(date));
+    };
+    const QList<DayMerge> merged = QtConcurrent::blockingMapped<QList<DayMerge>>(dates, mergeOne);
+
+    m_pending.clear();
+    m_pendingCount = 0;
+
+    QString firstError;
+    for (const DayMerge &day : merged) {
+        stats.imported += day.added;
+        stats.duplicates += day.duplicates;
+        if (day.written)
+            ++stats.daysWritten;
+        if (!day.ok && firstError.isEmpty())
+            firstError = day.error;
+    }
+
+    if (m_progress && m_device)
+        m_progress(m_device->pos(), m_device->size());
+
+    if (!firstError.isEmpty()) {
+        if (errorString)
+            *errorString = firstError;
+        return false;
+    }
+    return true;
+}
+
+bool EventImporter::readCsv(Stats &stats, QString *errorString)
+{
+    // Заголовок: разделитель и номера колонок
+    const QByteArray headerLine = m_device->peek(4096);
+    const int lineEnd = headerLine.indexOf('\n');
+    const QByteArray firstLine = lineEnd >= 0 ? headerLine.left(lineEnd) : headerLine;
+    const char separator = (firstLine.count(';') > firstLine.count(',')) ? ';' : ',';
+
+    QList<QByteArray> fields;
+    if (!readCsvRecord(m_device, separator, fields)) {
+        if (errorString)
+            *errorString = "Файл импорта пуст";
+        return false;
+    }
+    if (!fields.isEmpty() && fields.first().startsWith("\xEF\xBB\xBF"))
+        fields.first().remove(0, 3);    // BOM
+
+    int column[ColCount];
+    std::fill(column, column + ColCount, -1);
+    for (int i = 0; i < fields.size(); ++i) {
+        const int c = columnForHeader(QString::fromUtf8(fields.at(i)));
+        if (c >= 0 && column[c] < 0)
+            column[c] = i;
+    }
+    if (column[ColDate] < 0 && column[ColStart] < 0) {
+        if (errorString)
+            *errorString = "В заголовке CSV нет колонки date (или start с датой)";
+        return false;
+    }
+
+    auto field = [&fields, &column](int c) -> QByteArray {
+        const int i = column[c];
+        return (i >= 0 && i < fields.size()) ? fields.at(i) : QByteArray();
+    };
+
+    qint64 record = 1;
+    while (readCsvRecord(m_device, separator, fields)) {
+        ++record;
+        if (m_canceled.load())
+            break;
+        if (fields.size() == 1 && fields.first().isEmpty())
+            continue;       // пустая строка
+        ++stats.read;
+
+        QByteArray start = field(ColStart);
+        QDate date = parseDate(field(ColDate));
+        // start с датой: 2025-01-01T09:00 или 2025-01-01 09:00 (или только дата)
+        if (start.size() >= 10 && start.at(4) == '-') {
+            if (!date.isValid())
+                date = parseDate(start);
+            start = start.mid(11);
+        }
+        if (!date.isValid()) {
+            ++stats.skipped;
+            if (stats.firstProblem.isEmpty())
+                stats.firstProblem = QStringLiteral("Запись %1: нет даты").arg(record);
+            continue;
+        }
+
+        QByteArray end = field(ColEnd);
+        if (end.size() >= 10 && end.at(4) == '-')
+            end = end.mid(11);
+
+        Event e;
+        e.id = idFromText(field(ColId));
+        e.title = QString::fromUtf8(field(ColTitle));
+        e.start = parseTime(start);
+        e.end = parseTime(end);
+        // Событие без времени (только дата, мусор в колонке) в день не ложится
+        if (!e.start.isValid() || !e.end.isValid()) {
+            ++stats.skipped;
+            if (stats.firstProblem.isEmpty())
+                stats.firstProblem = QStringLiteral("Запись %1: нет времени начала или конца").arg(record);
+            continue;
+        }
+        e.tag = QString::fromUtf8(field(ColTag));
+        e.description = QString::fromUtf8(field(ColDescription));
+        if (!add(date, e, stats, errorString))
+            return false;
+    }
+    return true;
+}
+
+bool EventImporter::readIcs(Stats &stats, QString *errorString)
+{
+    bool inEvent = false;
+    QDate date;
+    QTime endTime;
+    QDate endDate;
+    qint64 durationSecs = -1;
+    bool recurring = false;
+    Event e;
+    QByteArray logical;     // текущая строка после «разворачивания» продолжений
+
+    auto finishEvent = [&]() -> bool {
+        ++stats.read;
+        if (!date.isValid()) {
+            ++stats.skipped;
+            if (stats.firstProblem.isEmpty())
+                stats.firstProblem = QStringLiteral("VEVENT «%1»: нет DTSTART").arg(e.title);
+            return true;
+        }
+        // Повторения не разворачиваются: одно событие вместо серии исказило бы итоги
+        if (recurring) {
+            ++stats.skipped;
+            if (stats.firstProblem.isEmpty())
+                stats.firstProblem = QStringLiteral("VEVENT «%1»: повторяющееся событие (RRULE/RDATE) не импортируется").arg(e.title);
+            return true;
+        }
+        // День хранит интервал не длиннее суток (конец раньше начала — переход
+        // через полночь); более длинные события не укладываются в формат дня
+        const qint64 spanDays = endDate.isValid() ? date.daysTo(endDate) : 0;
+        const qint64 spanSecs = endTime.isValid() && e.start.isValid()
+                                    ? spanDays * 86400 + e.start.secsTo(endTime)
+                                    : durationSecs;
+        if (spanSecs > 86400 || (endTime.isValid() && spanSecs < 0)) {
+            ++stats.skipped;
+            if (stats.firstProblem.isEmpty())
+                stats.firstProblem = QStringLiteral("VEVENT «%1»: длится больше суток или кончается раньше начала").arg(e.title);
+            return true;
+        }
+        if (endTime.isValid())
+            e.end = endTime;
+        else if (durationSecs >= 0 && e.start.isValid())
+            e.end = e.start.addSecs(int(durationSecs % 86400));
+        // Событие на весь день (VALUE=DATE) или без конца — без интервала времени
+        if (!e.start.isValid() || !e.end.isValid()) {
+            ++stats.skipped;
+            if (stats.firstProblem.isEmpty())
+                stats.firstProblem = QStringLiteral("VEVENT «%1»: нет времени начала или конца").arg(e.title);
+            return true;
+        }
+        return add(date, e, stats, errorString);
+    };
+
+    auto handleLine = [&](const QByteArray &line) -> bool {
+        const int colon = line.indexOf(':');
+        if (colon < 0)
+            return true;
+        const QByteArray head = line.left(colon);
+        const QByteArray value = line.mid(colon + 1);
+        const int semicolon = head.indexOf(';');
+        const QByteArray name = (semicolon < 0 ? head : head.left(semicolon)).toUpper();
+        const QByteArray params = semicolon < 0 ? QByteArray() : head.mid(semicolon + 1).toUpper();
+
+        if (name == "BEGIN" && value.trimmed().toUpper() == "VEVENT") {
+            inEvent = true;
+            e = Event();
+            date = QDate();
+            endDate = QDate();
+            endTime = QTime();
+            durationSecs = -1;
+            recurring = false;
+            return true;
+        }
+        if (!inEvent)
+            return true;
+        if (name == "END" && value.trimmed().toUpper() == "VEVENT") {
+            inEvent = false;
+            return finishEvent();
+        }
+
+        if (name == "UID")
+            e.id = idFromText(value);
+        else if (name == "SUMMARY")
+            e.title = unescapeIcsText(value);
+        else if (name == "DESCRIPTION")
+            e.description = unescapeIcsText(value);
+        else if (name == "CATEGORIES")
+            e.tag = unescapeIcsText(firstListItem(value)).trimmed();
+        else if (name == "DTSTART")
+            parseIcsDateTime(params, value, &date, &e.start);
+        else if (name == "DTEND")
+            parseIcsDateTime(params, value, &endDate, &endTime);
+        else if (name == "DURATION")
+            durationSecs = parseIcsDuration(value);
+        else if (name == "RRULE" || name == "RDATE")
+            recurring = true;
+        return true;
+    };
+
+    while (!m_device->atEnd()) {
+        if (m_canceled.load())
+            return true;
+        QByteArray line = m_device->readLine();
+        while (line.endsWith('\n') || line.endsWith('\r'))
+            line.chop(1);
+
+        // Строка, начинающаяся с пробела или табуляции, продолжает предыдущую
+        if (!line.isEmpty() && (line.at(0) == ' ' || line.at(0) == '\t')) {
+            logical += line.mid(1);
+            continue;
+        }
+        if (!logical.isEmpty() && !handleLine(logical))
+            return false;
+        logical = line;
+    }
+    if (!logical.isEmpty() && !handleLine(logical))
+        return false;
+    return true;
+}
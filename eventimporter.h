@@ -0,0 +1,86 @@
+#ifndef EVENTIMPORTER_H
+#define EVENTIMPORTER_H
+
+#include <QDate>
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include "daystore.h"
+#include "event.h"
+
+class QIODevice;
+
+// Массовый импорт событий из CSV и iCalendar (.ics) в каталог данных.
+// Файл читается один раз потоком; события копятся по датам в пачке
+// ограниченного размера (setBatchSize), затем каждый затронутый день пачки
+// сливается с тем, что уже лежит на диске, и записывается одним снимком
+// (дни — параллельно). Дубликаты отбрасываются по id, а события без
+// совпадающего id — по содержимому (время, название, тег, описание).
+// Выгрузки других трекеров обычно идут по датам, поэтому день, как
+// правило, попадает в одну пачку и пишется один раз.
+//
+// CSV: первая строка — заголовок; разделитель «,» или «;»; поля в кавычках
+// по RFC 4180 (в том числе с переводами строк). Колонки по имени:
+// date/дата, start/начало, end/конец, title/название, tag/тег,
+// description/описание, id/uid. start может содержать и дату
+// (yyyy-MM-ddTHH:mm или yyyy-MM-dd HH:mm) — тогда date не нужна.
+//
+// iCalendar: VEVENT с DTSTART, DTEND или DURATION, SUMMARY, CATEGORIES
+// (первая — тег), DESCRIPTION, UID. Время с Z переводится в местное,
+// TZID не разбирается (время считается местным). Пропускаются (Stats::skipped)
+// события на весь день, повторяющиеся (RRULE/RDATE — серии не разворачиваются)
+// и длиннее суток.
+class EventImporter
+{
+public:
+    enum class Format { Auto, Csv, Ics };
+
+    struct Stats {
+        qint64 read = 0;            // событий во входном файле
+        qint64 imported = 0;        // добавлено
+        qint64 duplicates = 0;      // уже были в данных (или повторялись во входе)
+        qint64 skipped = 0;         // без даты/времени (весь день), повторяющиеся, длиннее суток, с ошибкой формата
+        int daysWritten = 0;
+        QString firstProblem;       // первая пропущенная запись — для сообщения
+    };
+
+    explicit EventImporter(const DayStore &store);
+
+    // Событий в пачке; больше — пачка записывается (память ограничена ей)
+    void setBatchSize(int events) { m_batchSize = qMax(1, events); }
+    // Вызывается после каждой записанной пачки: прочитано байт из total
+    void setProgressCallback(const std::function<void(qint64 done, qint64 total)> &callback)
+    {
+        m_progress = callback;
+    }
+
+    // Auto — по расширению: .ics/.ical — iCalendar, иначе CSV
+    bool importFile(const QString &path, Format format = Format::Auto,
+                    Stats *stats = nullptr, QString *errorString = nullptr);
+    bool importDevice(QIODevice *device, Format format,
+                      Stats *stats = nullptr, QString *errorString = nullptr);
+
+    // Из другого потока: чтение прекращается, уже записанные дни остаются
+    void cancel() { m_canceled.store(true); }
+
+private:
+    const DayStore m_store;
+    int m_batchSize = 50000;
+    std::function<void(qint64, qint64)> m_progress;
+    std::atomic<bool> m_canceled { false };
+
+    QHash<QDate, QVector<Event>> m_pending;
+    int m_pendingCount = 0;
+    QIODevice *m_device = nullptr;
+
+    bool readCsv(Stats &stats, QString *errorString);
+    bool readIcs(Stats &stats, QString *errorString);
+
+    // Событие в пачку; пачка заполнилась — запись
+    bool add(const QDate &date, const Event &e, Stats &stats, QString *errorString);
+    bool flush(Stats &stats, QString *errorString);
+};
+
+#endif // EVENTIMPORTER_H
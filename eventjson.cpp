@@ -0,0 +1,82 @@
+#include "eventjson.h"
+#include "eventscanner.h"
+
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+
+bool EventJson::parseDay(const QByteArray &data, QVector<Event> &out,
+                         int *missingIds, QString *errorString)
+{
+    return EventScanner::parseDay(data, out, EventScanner::AllFields, missingIds, errorString);
+}
+
+bool EventJson::parseDayDocument(const QByteArray &data, QVector<Event> &out,
+                                 int *missingIds, QString *errorString)
+{
+    out.clear();
+    if (missingIds) *missingIds = 0;
+
+    QJsonParseError err{};
+    const QJsonDocument doc = QJsonDocument::fromJson(data, &err);
+    if (err.error != QJsonParseError::NoError) {
+        if (errorString) *errorString = QStringLiteral("Некорректный JSON: ") + err.errorString();
+        return false;
+    }
+
+    // Поддерживаем два формата: массив верхнего уровня ИЛИ объект с массивом "events"
+    QJsonArray arr;
+    if (doc.isArray()) {
+        arr = doc.array();
+    } else if (doc.isObject()) {
+        arr = doc.object().value(QStringLiteral("events")).toArray();
+    } else {
+        if (errorString) *errorString = QStringLiteral("Ожидался массив событий");
+        return false;
+    }
+
+    out.reserve(arr.size());
+    for (const QJsonValue &val : arr) {
+        if (!val.isObject())
+            continue;
+
+        const Event e = fromJson(val.toObject());
+        if (e.id.isNull() && missingIds)
+            ++*missingIds;
+        out.append(e);
+    }
+    return true;
+}
+
+QByteArray EventJson::serializeDay(const QVector<Event> &events)
+{
+    QJsonArray arr;
+    for (const Event &e : events)
+        arr.append(toJson(e));
+    return QJsonDocument(arr).toJson(QJsonDocument::Indented);
+}
+
+QJsonObject EventJson::toJson(const Event &e)
+{
+    QJsonObject obj;
+    obj["id"]    = e.id.toString(QUuid::WithoutBraces);  // ✅ сохраняем id
+    obj["title"] = e.title;
+    obj["start"] = e.start.toString("HH:mm");
+    obj["end"]   = e.end.toString("HH:mm");
+    obj["tag"]   = e.tag;
+    obj["description"] = e.description;
+    return obj;
+}
+
+Event EventJson::fromJson(const QJsonObject &obj)
+{
+    Event e;
+    // ✅ обратносовместимая загрузка id: без "id" остаётся пустой QUuid
+    e.id = QUuid::fromString(obj.value(QStringLiteral("id")).toString());
+    e.title = obj.value(QStringLiteral("title")).toString();
+    e.start = QTime::fromString(obj.value(QStringLiteral("start")).toString(), QStringLiteral("HH:mm"));
+    e.end   = QTime::fromString(obj.value(QStringLiteral("end")).toString(),   QStringLiteral("HH:mm"));
+    e.tag = obj.value(QStringLiteral("tag")).toString();
+    e.description = obj.value(QStringLiteral("description")).toString();
+    return e;
+}
@@ -0,0 +1,34 @@
+#ifndef EVENTJSON_H
+#define EVENTJSON_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+#include "event.h"
+
+// Чтение/запись файла дня (yyyy-MM-dd.json) без зависимостей от виджетов.
+class EventJson
+{
+public:
+    // Разбор содержимого файла дня. Поддерживаются два формата:
+    // массив верхнего уровня ИЛИ объект с массивом "events".
+    // События без корректного "id" получают пустой QUuid — их число
+    // возвращается через missingIds (генерацией id занимается вызывающий).
+    // Разбор потоковый (EventScanner), без дерева QJsonDocument.
+    static bool parseDay(const QByteArray &data, QVector<Event> &out,
+                         int *missingIds = nullptr, QString *errorString = nullptr);
+
+    // Прежний разбор через QJsonDocument — эталон для сравнения в бенчмарке
+    static bool parseDayDocument(const QByteArray &data, QVector<Event> &out,
+                                 int *missingIds = nullptr, QString *errorString = nullptr);
+
+    // Сериализация в формат, который пишет главное окно (массив, Indented)
+    static QByteArray serializeDay(const QVector<Event> &events);
+
+    // Одно событие <-> JSON-объект (общий формат для файла дня и журнала)
+    static QJsonObject toJson(const Event &e);
+    static Event fromJson(const QJsonObject &obj);
+};
+
+#endif // EVENTJSON_H
@@ -0,0 +1,168 @@
+#include "eventlistmodel.h"
+#include "trace.h"
+
+#include <QHash>
+#include <QSet>
+#include <algorithm>
+#include <utility>
+
+EventListModel::EventListModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+EventListModel::Row EventListModel::makeRow(const Event &e)
+{
+    Row row;
+    row.startMinute = e.start.isValid() ? e.start.hour() * 60 + e.start.minute() : -1;
+    row.titleKey = e.title.toLower();
+    row.event = e;
+    return row;
+}
+
+bool EventListModel::lessThan(const Row &a, const Row &b)
+{
+    if (a.startMinute != b.startMinute)
+        return a.startMinute < b.startMinute;
+    return a.titleKey < b.titleKey;
+}
+
+int EventListModel::insertPosition(const Row &row) const
+{
+    return int(std::upper_bound(m_rows.cbegin(), m_rows.cend(), row, lessThan) - m_rows.cbegin());
+}
+
+void EventListModel::setEvents(const QVector<Event> &events)
+{
+    TRACE_SCOPE_CAT("EventListModel::setEvents", "ui");
+    beginResetModel();
+    m_rows.clear();
+    m_rows.reserve(events.size());
+    for (const Event &e : events)
+        m_rows.append(makeRow(e));
+    std::stable_sort(m_rows.begin(), m_rows.end(), lessThan);
+    endResetModel();
+}
+
+void EventListModel::syncEvents(const QVector<Event> &events)
+{
+    if (m_rows.isEmpty() || events.isEmpty()) {
+        setEvents(events);
+        return;
+    }
+
+    QHash<QUuid, Event> current;
+    current.reserve(m_rows.size());
+    for (const Row &row : std::as_const(m_rows))
+        current.insert(row.event.id, row.event);
+
+    QSet<QUuid> incoming;
+    incoming.reserve(events.size());
+    for (const Event &e : events)
+        incoming.insert(e.id);
+
+    // Удалённые — с конца, чтобы номера строк впереди не съезжали
+    for (int row = m_rows.size() - 1; row >= 0; --row) {
+        if (incoming.contains(m_rows.at(row).event.id))
+            continue;
+        beginRemoveRows(QModelIndex(), row, row);
+        m_rows.removeAt(row);
+        endRemoveRows();
+    }
+
+    for (const Event &e : events) {
+        const auto it = current.constFind(e.id);
+        if (it == current.constEnd())
+            insertEvent(e);
+        else if (!sameContent(it.value(), e))
+            updateEvent(it.value(), e);
+    }
+}
+
+bool EventListModel::sameContent(const Event &a, const Event &b)
+{
+    return a.id == b.id && a.title == b.title && a.start == b.start && a.end == b.end
+           && a.tag == b.tag && a.description == b.description;
+}
+
+int EventListModel::insertEvent(const Event &e)
+{
+    const Row row = makeRow(e);
+    const int pos = insertPosition(row);
+    beginInsertRows(QModelIndex(), pos, pos);
+    m_rows.insert(pos, row);
+    endInsertRows();
+    return pos;
+}
+
+int EventListModel::updateEvent(const Event &before, const Event &after)
+{
+    const int from = rowOf(before);
+    if (from < 0)
+        return -1;
+
+    // Позиция в списке без самой строки: всё, что правее from, сдвигается на одну
+    const Row row = makeRow(after);
+    int to = insertPosition(row);
+    if (to > from)
+        --to;
+
+    if (to != from) {
+        beginMoveRows(QModelIndex(), from, from, QModelIndex(), to > from ? to + 1 : to);
+        m_rows.move(from, to);
+        m_rows[to] = row;
+        endMoveRows();
+    } else {
+        m_rows[to] = row;
+    }
+
+    const QModelIndex idx = index(to);
+    emit dataChanged(idx, idx);
+    return to;
+}
+
+bool EventListModel::removeEvent(const Event &e)
+{
+    const int row = rowOf(e);
+    if (row < 0)
+        return false;
+    beginRemoveRows(QModelIndex(), row, row);
+    m_rows.removeAt(row);
+    endRemoveRows();
+    return true;
+}
+
+int EventListModel::rowOf(const Event &e) const
+{
+    // Бинарный поиск по ключу, затем id среди строк с тем же ключом
+    const Row key = makeRow(e);
+    const auto range = std::equal_range(m_rows.cbegin(), m_rows.cend(), key, lessThan);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->event.id == e.id)
+            return int(it - m_rows.cbegin());
+    }
+    return -1;
+}
+
+int EventListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+QVariant EventListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() < 0 || index.row() >= m_rows.size())
+        return QVariant();
+
+    const Event &e = m_rows.at(index.row()).event;
+    switch (role) {
+    case Qt::DisplayRole:
+        return e.toDisplayString();
+    case Qt::ToolTipRole:
+        return e.description.isEmpty() ? QVariant() : QVariant(e.description);
+    case IdRole:
+        return QVariant::fromValue(e.id);
+    default:
+        return QVariant();
+    }
+}
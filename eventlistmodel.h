@@ -0,0 +1,59 @@
+#ifndef EVENTLISTMODEL_H
+#define EVENTLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QVector>
+#include "event.h"
+
+// Список событий одного дня для QListView. Строки всегда отсортированы:
+// сначала события без времени (по названию), затем по времени начала
+// (при равенстве — по названию). Ключ сортировки считается один раз при
+// вставке/изменении; правка одного события — бинарный поиск позиции и
+// точечные сигналы вставки/удаления/перемещения строк вместо полной пересборки.
+class EventListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles {
+        IdRole = Qt::UserRole   // id события (QUuid)
+    };
+
+    explicit EventListModel(QObject *parent = nullptr);
+
+    // Полная замена содержимого (смена дня)
+    void setEvents(const QVector<Event> &events);
+    // Тот же день перечитан с диска: точечно применяем разницу по id,
+    // выделение и прокрутка остаются на месте
+    void syncEvents(const QVector<Event> &events);
+
+    // Точечные изменения; возвращают строку события после операции (-1 — не найдено).
+    // Строка ищется по ключу сортировки прежней версии события, поэтому
+    // передаётся событие целиком (id + поля, как они лежат в модели).
+    int insertEvent(const Event &e);
+    int updateEvent(const Event &before, const Event &after);
+    bool removeEvent(const Event &e);
+
+    int rowOf(const Event &e) const;
+    const Event &eventAt(int row) const { return m_rows.at(row).event; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+private:
+    struct Row {
+        int startMinute;    // -1 — время не задано
+        QString titleKey;   // название в нижнем регистре
+        Event event;
+    };
+
+    QVector<Row> m_rows;
+
+    static Row makeRow(const Event &e);
+    static bool sameContent(const Event &a, const Event &b);
+    static bool lessThan(const Row &a, const Row &b);
+    // Позиция вставки (после равных — порядок добавления сохраняется)
+    int insertPosition(const Row &row) const;
+};
+
+#endif // EVENTLISTMODEL_H
@@ -0,0 +1,359 @@
+#include "eventquery.h"
+#include "daystore.h"
+#include "eventarchive.h"
+#include "eventcolumns.h"
+#include "taganalyzer.h"
+#include "trace.h"
+
+#include <QtConcurrent>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const QStringList kWeekdays = {
+    QStringLiteral("Пн"), QStringLiteral("Вт"), QStringLiteral("Ср"), QStringLiteral("Чт"),
+    QStringLiteral("Пт"), QStringLiteral("Сб"), QStringLiteral("Вс")
+};
+
+// Строки одного прохода: колонки архива месяца или дни, разобранные из JSON.
+// Тег и название — id, текст по id отдают tagText/titleText.
+struct Columns {
+    const qint32 *date = nullptr;
+    const qint16 *start = nullptr;
+    const qint16 *end = nullptr;
+    const quint32 *tag = nullptr;
+    const quint32 *title = nullptr;
+    int tagCount = 0;
+    std::function<QString(quint32)> tagText;
+    std::function<QString(quint32)> titleText;
+};
+
+// Длительность строк [0, n) в минутах; end < start — переход через полночь
+// (+24 ч), строка без времени — -1. Без ветвлений: цикл векторизуется
+void computeDurations(const qint16 *start, const qint16 *end, int n, qint16 *out)
+{
+    for (int i = 0; i < n; ++i) {
+        const int s = start[i];
+        const int e = end[i];
+        int d = e - s;
+        d += (d < 0) * (24 * 60);
+        const int invalid = (s < 0) | (e < 0);
+        out[i] = qint16(d | -invalid);      // -1 | d == -1
+    }
+}
+
+// Маска отбора: длительность в [lo, hi] и разрешённый тег
+void computeMask(const qint16 *durations, const quint32 *tags, const quint8 *tagAllowed,
+                 int lo, int hi, int n, quint8 *out)
+{
+    for (int i = 0; i < n; ++i) {
+        const int d = durations[i];
+        out[i] = quint8((d >= lo) & (d <= hi) & tagAllowed[tags[i]]);
+    }
+}
+
+void mergeGroup(EventQuery::Group &into, const EventQuery::Group &group)
+{
+    if (into.count == 0) {
+        into = group;
+        return;
+    }
+    into.sum += group.sum;
+    into.count += group.count;
+    into.min = qMin(into.min, group.min);
+    into.max = qMax(into.max, group.max);
+}
+
+void mergePartial(EventQuery::Partial &result, const EventQuery::Partial &part)
+{
+    for (auto it = part.constBegin(); it != part.constEnd(); ++it)
+        mergeGroup(result[it.key()], it.value());
+}
+
+// Строки [begin, end) одного набора колонок месяца month — в частичный результат
+void scan(const Columns &c, int begin, int end, const QDate &month,
+          EventQuery::GroupBy groupBy, const EventQuery::Filter &filter, EventQuery::Partial &partial)
+{
+    const int n = end - begin;
+    if (n <= 0)
+        return;
+
+    const qint32 *date = c.date + begin;
+    const qint16 *start = c.start + begin;
+    const quint32 *tag = c.tag + begin;
+
+    // Таблица разрешённых тегов по id: фильтр по подписи считается один раз на id
+    QVector<quint8> tagAllowed(qMax(1, c.tagCount), 1);
+    if (!filter.tags.isEmpty()) {
+        for (int id = 0; id < c.tagCount; ++id)
+            tagAllowed[id] = filter.tags.contains(TagAnalyzer::tagLabel(c.tagText(quint32(id)))) ? 1 : 0;
+    }
+
+    QVector<qint16> durations(n);
+    QVector<quint8> selected(n);
+    computeDurations(start, c.end + begin, n, durations.data());
+    computeMask(durations.constData(), tag, tagAllowed.constData(),
+                qMax(0, filter.minMinutes), filter.maxMinutes, n, selected.data());
+
+    // Ключ группы — плотный номер, агрегаты — в массивах по номеру
+    QVector<int> keys(n);
+    int keyCount = 0;
+    QVector<quint32> titleOfKey;
+    switch (groupBy) {
+    case EventQuery::GroupBy::Tag:
+        for (int i = 0; i < n; ++i)
+            keys[i] = int(tag[i]);
+        keyCount = c.tagCount;
+        break;
+    case EventQuery::GroupBy::Weekday:
+        for (int i = 0; i < n; ++i)
+            keys[i] = date[i] % 7;              // как QDate::dayOfWeek() - 1
+        keyCount = 7;
+        break;
+    case EventQuery::GroupBy::Hour:
+        for (int i = 0; i < n; ++i)
+            keys[i] = qMax(0, int(start[i])) / 60;
+        keyCount = 24;
+        break;
+    case EventQuery::GroupBy::Month:
+        keys.fill(0);
+        keyCount = 1;
+        break;
+    case EventQuery::GroupBy::Title: {
+        // Названия в архиве интернированы: одинаковый текст — одно смещение
+        QHash<quint32, int> keyOfTitle;
+        const quint32 *title = c.title + begin;
+        for (int i = 0; i < n; ++i) {
+            if (!selected[i])
+                continue;
+            auto it = keyOfTitle.constFind(title[i]);
+            if (it == keyOfTitle.constEnd()) {
+                it = keyOfTitle.insert(title[i], titleOfKey.size());
+                titleOfKey.append(title[i]);
+            }
+            keys[i] = it.value();
+        }
+        keyCount = titleOfKey.size();
+        break;
+    }
+    }
+
+    QVector<qint64> sums(keyCount, 0);
+    QVector<qint64> counts(keyCount, 0);
+    QVector<int> mins(keyCount, 24 * 60);
+    QVector<int> maxs(keyCount, 0);
+    for (int i = 0; i < n; ++i) {
+        if (!selected[i])
+            continue;
+        const int k = keys[i];
+        const int d = durations[i];
+        sums[k] += d;
+        ++counts[k];
+        mins[k] = qMin(mins[k], d);
+        maxs[k] = qMax(maxs[k], d);
+    }
+
+    for (int k = 0; k < keyCount; ++k) {
+        if (counts[k] == 0)
+            continue;
+        EventQuery::Group group;
+        group.sum = sums[k];
+        group.count = counts[k];
+        group.min = mins[k];
+        group.max = maxs[k];
+        switch (groupBy) {
+        case EventQuery::GroupBy::Tag:
+            group.key = TagAnalyzer::tagLabel(c.tagText(quint32(k)));
+            break;
+        case EventQuery::GroupBy::Weekday:
+            group.key = kWeekdays.at(k);
+            group.order = k;
+            break;
+        case EventQuery::GroupBy::Hour:
+            group.key = QStringLiteral("%1:00").arg(k, 2, 10, QLatin1Char('0'));
+            group.order = k;
+            break;
+        case EventQuery::GroupBy::Month:
+            group.key = month.toString("yyyy-MM");
+            group.order = month.year() * 12 + month.month();
+            break;
+        case EventQuery::GroupBy::Title: {
+            const QString title = c.titleText(titleOfKey.at(k)).trimmed();
+            group.key = title.isEmpty() ? QStringLiteral("(без названия)") : title;
+            break;
+        }
+        }
+        mergeGroup(partial[group.key], group);
+    }
+}
+
+// Дни одного месяца в пределах фильтра: архивы каталогов, а где архива
+// нет (например, каталог только для чтения) — разбор JSON дней
+EventQuery::Partial queryMonth(const QStringList &dataDirs, EventQuery::GroupBy groupBy,
+                               const EventQuery::Filter &filter, const QDate &month)
+{
+    TRACE_SCOPE("EventQuery::queryMonth");
+    EventQuery::Partial partial;
+    const QDate first = qMax(filter.from, month);
+    const QDate last = qMin(filter.to, month.addMonths(1).addDays(-1));
+
+    const int dirCount = dataDirs.size();
+    std::vector<std::unique_ptr<EventArchive>> archives(dirCount);
+    std::vector<Columns> columns(dirCount);
+    for (int i = 0; i < dirCount; ++i) {
+        std::unique_ptr<EventArchive> archive(new EventArchive);
+        if (!archive->openFresh(dataDirs[i], month))
+            continue;
+        Columns &c = columns[i];
+        c.date = archive->dateColumn();
+        c.start = archive->startColumn();
+        c.end = archive->endColumn();
+        c.tag = archive->tagColumn();
+        c.title = archive->titleColumn();
+        c.tagCount = archive->tagCount();
+        const EventArchive *a = archive.get();
+        c.tagText = [a](quint32 id) { return a->tag(id); };
+        c.titleText = [a](quint32 offset) { return a->string(offset); };
+        archives[i] = std::move(archive);
+    }
+
+    // Дни без архива — в свои колонки
+    TagDictionary fallbackTags;
+    TagDictionary fallbackTitles;
+    QVector<qint32> fbDate;
+    QVector<qint16> fbStart, fbEnd;
+    QVector<quint32> fbTag, fbTitle;
+    EventScanner::Fields fields = EventScanner::TimeAndTag;
+    if (groupBy == EventQuery::GroupBy::Title)
+        fields |= EventScanner::Title;
+
+    // Подряд идущие дни одного архива — один проход по непрерывным строкам
+    std::vector<int> rangeBegin(dirCount, 0), rangeEnd(dirCount, 0);
+    auto flush = [&](int i) {
+        scan(columns[i], rangeBegin[i], rangeEnd[i], month, groupBy, filter, partial);
+        rangeBegin[i] = rangeEnd[i] = 0;
+    };
+
+    QVector<Event> events;
+    for (QDate date = first; date <= last; date = date.addDays(1)) {
+        for (int i = 0; i < dirCount; ++i) {
+            if (archives[i]) {
+                if (!archives[i]->hasDay(date))
+                    continue;
+                const int row = archives[i]->firstRowOfDay(date);
+                if (row != rangeEnd[i] || rangeBegin[i] == rangeEnd[i]) {
+                    flush(i);
+                    rangeBegin[i] = rangeEnd[i] = row;
+                }
+                rangeEnd[i] += archives[i]->rowCountOfDay(date);
+                break;
+            }
+
+            const DayStore store(dataDirs[i]);
+            if (!store.signature(date).exists())
+                continue;
+            // Битые файлы пропускаем молча, как и анализ по тегам
+            if (store.loadFields(date, events, fields)) {
+                for (const Event &e : std::as_const(events)) {
+                    fbDate.append(qint32(date.toJulianDay()));
+                    fbStart.append(EventColumns::minutesOf(e.start));
+                    fbEnd.append(EventColumns::minutesOf(e.end));
+                    fbTag.append(fallbackTags.intern(e.tag));
+                    fbTitle.append(fallbackTitles.intern(e.title));
+                }
+            }
+            break;
+        }
+    }
+    for (int i = 0; i < dirCount; ++i) {
+        if (archives[i])
+            flush(i);
+    }
+
+    if (!fbDate.isEmpty()) {
+        Columns c;
+        c.date = fbDate.constData();
+        c.start = fbStart.constData();
+        c.end = fbEnd.constData();
+        c.tag = fbTag.constData();
+        c.title = fbTitle.constData();
+        c.tagCount = fallbackTags.size();
+        c.tagText = [&fallbackTags](quint32 id) { return fallbackTags.tag(id); };
+        c.titleText = [&fallbackTitles](quint32 id) { return fallbackTitles.tag(id); };
+        scan(c, 0, fbDate.size(), month, groupBy, filter, partial);
+    }
+    return partial;
+}
+
+} // namespace
+
+EventQuery::EventQuery(const QStringList &dataDirs)
+    : m_dataDirs(dataDirs)
+{
+}
+
+QFuture<EventQuery::Partial> EventQuery::runConcurrent(GroupBy groupBy, const Filter &filter) const
+{
+    // Все месяцы диапазона; пустые по оглавлениям отсеиваются уже в пуле —
+    // оглавление может читать файлы, вызывающему потоку ждать нельзя
+    QVector<QDate> months;
+    if (filter.from.isValid() && filter.to.isValid()) {
+        for (QDate month(filter.from.year(), filter.from.month(), 1); month <= filter.to;
+             month = month.addMonths(1))
+            months.append(month);
+    }
+
+    const QStringList dataDirs = m_dataDirs;
+    const std::function<Partial(const QDate &)> mapMonth =
+        [dataDirs, groupBy, filter](const QDate &month) {
+            const QDate first = qMax(filter.from, month);
+            const QDate last = qMin(filter.to, month.addMonths(1).addDays(-1));
+            if (TagAnalyzer(dataDirs).populatedDays(first, last).isEmpty())
+                return Partial();
+            return queryMonth(dataDirs, groupBy, filter, month);
+        };
+
+    return QtConcurrent::mappedReduced<Partial>(
+        months, mapMonth, mergePartial, QtConcurrent::UnorderedReduce);
+}
+
+EventQuery::Result EventQuery::run(GroupBy groupBy, const Filter &filter) const
+{
+    TRACE_SCOPE("EventQuery::run");
+    return finish(groupBy, runConcurrent(groupBy, filter).result());
+}
+
+EventQuery::Result EventQuery::finish(GroupBy groupBy, const Partial &partial)
+{
+    Result result;
+    result.groups.reserve(partial.size());
+    for (auto it = partial.constBegin(); it != partial.constEnd(); ++it) {
+        result.groups.append(it.value());
+        result.sum += it.value().sum;
+        result.count += it.value().count;
+    }
+
+    const bool byValue = groupBy == GroupBy::Tag || groupBy == GroupBy::Title;
+    std::sort(result.groups.begin(), result.groups.end(), [byValue](const Group &a, const Group &b) {
+        if (byValue)
+            return a.sum != b.sum ? a.sum > b.sum : a.key < b.key;
+        return a.order < b.order;
+    });
+    return result;
+}
+
+QString EventQuery::groupByName(GroupBy groupBy)
+{
+    switch (groupBy) {
+    case GroupBy::Tag:     return QStringLiteral("Тег");
+    case GroupBy::Weekday: return QStringLiteral("День недели");
+    case GroupBy::Hour:    return QStringLiteral("Час начала");
+    case GroupBy::Month:   return QStringLiteral("Месяц");
+    case GroupBy::Title:   return QStringLiteral("Название");
+    }
+    return QString();
+}
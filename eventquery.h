@@ -0,0 +1,72 @@
+#ifndef EVENTQUERY_H
+#define EVENTQUERY_H
+
+#include <QDate>
+#include <QFuture>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Запросы «группировка + агрегаты» по событиям за диапазон дат для
+// сводной таблицы анализа: группа — тег, день недели, час начала, месяц
+// или название; фильтры — теги и длительность; на выходе по группам сумма,
+// число, минимум, максимум и среднее длительности.
+//
+// Данные берутся из помесячных колоночных архивов (EventArchive) — JSON
+// дней разбирается только при пересборке устаревшего архива, так что новые
+// отчёты не добавляют своих проходов по файлам. Месяцы считаются
+// параллельно; внутри месяца проходы идут по непрерывным колонкам целых
+// чисел без ветвлений (длительность с переходом через полночь, маска
+// фильтра, ключ группы), что компилятор векторизует.
+class EventQuery
+{
+public:
+    enum class GroupBy { Tag, Weekday, Hour, Month, Title };
+
+    struct Filter {
+        QDate from;
+        QDate to;
+        QSet<QString> tags;             // подписи тегов (TagAnalyzer::tagLabel); пусто — все
+        int minMinutes = 0;
+        int maxMinutes = 24 * 60;
+    };
+
+    struct Group {
+        QString key;
+        int order = 0;                  // для упорядочения по значению ключа
+        qint64 sum = 0;                 // минуты
+        qint64 count = 0;
+        int min = 0;
+        int max = 0;
+        double average() const { return count > 0 ? double(sum) / count : 0.0; }
+    };
+
+    // Группы: тег и название — по убыванию суммы, остальное — по значению ключа
+    struct Result {
+        QVector<Group> groups;
+        qint64 sum = 0;
+        qint64 count = 0;
+    };
+
+    // Частичный результат одного месяца (ключ — Group::key)
+    using Partial = QHash<QString, Group>;
+
+    // Каталоги просматриваются по порядку, как в TagAnalyzer
+    explicit EventQuery(const QStringList &dataDirs);
+
+    // Прогресс (в месяцах) и отмена — через QFutureWatcher
+    QFuture<Partial> runConcurrent(GroupBy groupBy, const Filter &filter) const;
+    Result run(GroupBy groupBy, const Filter &filter) const;
+
+    // Частичные результаты → упорядоченные группы с итогами
+    static Result finish(GroupBy groupBy, const Partial &partial);
+
+    static QString groupByName(GroupBy groupBy);
+
+private:
+    QStringList m_dataDirs;
+};
+
+#endif // EVENTQUERY_H
@@ -0,0 +1,474 @@
+#include "eventscanner.h"
+#include "trace.h"
+
+#include <QtAlgorithms>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define EVENTSCANNER_SSE2
+#endif
+
+namespace {
+
+// --- Поиск байтов: по 16 за раз с SSE2, хвост — побайтно ---
+
+// Первая кавычка или обратный слэш (конец/экранирование внутри строки)
+const char *findQuoteOrEscape(const char *p, const char *end)
+{
+#ifdef EVENTSCANNER_SSE2
+    const __m128i quote  = _mm_set1_epi8('"');
+    const __m128i escape = _mm_set1_epi8('\\');
+    while (end - p >= 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        const int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                                        _mm_cmpeq_epi8(chunk, escape)));
+        if (mask)
+            return p + qCountTrailingZeroBits(quint32(mask));
+        p += 16;
+    }
+#endif
+    while (p < end && *p != '"' && *p != '\\')
+        ++p;
+    return p;
+}
+
+// Первый структурный символ внутри пропускаемого объекта/массива
+const char *findStructural(const char *p, const char *end)
+{
+#ifdef EVENTSCANNER_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i openA = _mm_set1_epi8('[');
+    const __m128i closeA = _mm_set1_epi8(']');
+    const __m128i openO = _mm_set1_epi8('{');
+    const __m128i closeO = _mm_set1_epi8('}');
+    while (end - p >= 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i hit = _mm_cmpeq_epi8(chunk, quote);
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(chunk, openA));
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(chunk, closeA));
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(chunk, openO));
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(chunk, closeO));
+        const int mask = _mm_movemask_epi8(hit);
+        if (mask)
+            return p + qCountTrailingZeroBits(quint32(mask));
+        p += 16;
+    }
+#endif
+    while (p < end && *p != '"' && *p != '[' && *p != ']' && *p != '{' && *p != '}')
+        ++p;
+    return p;
+}
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+// Пропуск пробелов; в файлах с отступами (Indented) их длинные серии
+const char *skipSpaces(const char *p, const char *end)
+{
+#ifdef EVENTSCANNER_SSE2
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i tab = _mm_set1_epi8('\t');
+    while (end - p >= 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i ws = _mm_cmpeq_epi8(chunk, space);
+        ws = _mm_or_si128(ws, _mm_cmpeq_epi8(chunk, lf));
+        ws = _mm_or_si128(ws, _mm_cmpeq_epi8(chunk, cr));
+        ws = _mm_or_si128(ws, _mm_cmpeq_epi8(chunk, tab));
+        const int other = ~_mm_movemask_epi8(ws) & 0xffff;
+        if (other)
+            return p + qCountTrailingZeroBits(quint32(other));
+        p += 16;
+    }
+#endif
+    while (p < end && isSpace(*p))
+        ++p;
+    return p;
+}
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Строка JSON как срез исходного буфера (без кавычек)
+struct Slice {
+    const char *begin = nullptr;
+    const char *end = nullptr;
+    bool escaped = false;   // внутри есть '\' — нужна раскодировка
+
+    int size() const { return int(end - begin); }
+    bool equals(const char *literal, int length) const
+    {
+        return !escaped && size() == length && std::memcmp(begin, literal, size_t(length)) == 0;
+    }
+};
+
+class Scanner
+{
+public:
+    Scanner(const QByteArray &data, EventScanner::Fields fields)
+        : m_begin(data.constData()), m_p(data.constData()), m_end(data.constData() + data.size())
+        , m_fields(fields)
+    {
+    }
+
+    bool parse(QVector<Event> &out, int *missingIds);
+    QString error() const { return m_error; }
+
+private:
+    const char *m_begin;
+    const char *m_p;
+    const char *m_end;
+    EventScanner::Fields m_fields;
+    QString m_error;
+
+    bool fail(const QString &what)
+    {
+        if (m_error.isEmpty())
+            m_error = QStringLiteral("Некорректный JSON: %1 (смещение %2)").arg(what).arg(m_p - m_begin);
+        return false;
+    }
+
+    void skipWs() { m_p = skipSpaces(m_p, m_end); }
+    bool atEnd() const { return m_p >= m_end; }
+    bool expect(char c, const char *what)
+    {
+        skipWs();
+        if (atEnd() || *m_p != c)
+            return fail(QString::fromUtf8(what));
+        ++m_p;
+        return true;
+    }
+
+    bool readString(Slice &slice);
+    bool skipValue();
+    bool parseEvents(QVector<Event> &out, int *missingIds);
+    bool parseEvent(Event &e);
+
+    static bool decode(const Slice &slice, QString &value);
+    static QTime decodeTime(const Slice &slice);
+};
+
+// m_p стоит на открывающей кавычке
+bool Scanner::readString(Slice &slice)
+{
+    ++m_p;
+    slice.begin = m_p;
+    slice.escaped = false;
+    for (;;) {
+        m_p = findQuoteOrEscape(m_p, m_end);
+        if (atEnd())
+            return fail(QStringLiteral("незакрытая строка"));
+        if (*m_p == '"')
+            break;
+        slice.escaped = true;
+        m_p += 2;   // '\' и экранированный символ
+        if (m_p > m_end)
+            return fail(QStringLiteral("незакрытая строка"));
+    }
+    slice.end = m_p;
+    ++m_p;
+    return true;
+}
+
+bool Scanner::skipValue()
+{
+    skipWs();
+    if (atEnd())
+        return fail(QStringLiteral("ожидалось значение"));
+
+    Slice ignored;
+    switch (*m_p) {
+    case '"':
+        return readString(ignored);
+    case '{':
+    case '[': {
+        // Внутрь не заходим: считаем только глубину скобок, строки перепрыгиваем целиком
+        int depth = 0;
+        for (;;) {
+            m_p = findStructural(m_p, m_end);
+            if (atEnd())
+                return fail(QStringLiteral("незакрытый объект или массив"));
+            const char c = *m_p;
+            if (c == '"') {
+                if (!readString(ignored))
+                    return false;
+                continue;
+            }
+            ++m_p;
+            if (c == '{' || c == '[') {
+                ++depth;
+            } else if (--depth == 0) {
+                return true;
+            }
+        }
+    }
+    default: {
+        // Число или литерал: до разделителя
+        const char *start = m_p;
+        while (!atEnd() && *m_p != ',' && *m_p != '}' && *m_p != ']' && !isSpace(*m_p))
+            ++m_p;
+        if (m_p == start)
+            return fail(QStringLiteral("ожидалось значение"));
+        return true;
+    }
+    }
+}
+
+bool Scanner::parse(QVector<Event> &out, int *missingIds)
+{
+    skipWs();
+    if (atEnd())
+        return fail(QStringLiteral("пустые данные"));
+
+    if (*m_p == '[') {
+        if (!parseEvents(out, missingIds))
+            return false;
+    } else if (*m_p == '{') {
+        // Объект: нужен только массив "events", прочие ключи пропускаем
+        ++m_p;
+        skipWs();
+        if (!atEnd() && *m_p == '}') {
+            ++m_p;
+        } else {
+            for (;;) {
+                skipWs();
+                Slice key;
+                if (atEnd() || *m_p != '"')
+                    return fail(QStringLiteral("ожидался ключ"));
+                if (!readString(key) || !expect(':', "ожидалось ':'"))
+                    return false;
+                skipWs();
+                if (key.equals("events", 6) && !atEnd() && *m_p == '[') {
+                    out.clear();
+                    if (missingIds) *missingIds = 0;
+                    if (!parseEvents(out, missingIds))
+                        return false;
+                } else if (!skipValue()) {
+                    return false;
+                }
+                skipWs();
+                if (!atEnd() && *m_p == ',') { ++m_p; continue; }
+                if (!expect('}', "ожидалось ',' или '}'"))
+                    return false;
+                break;
+            }
+        }
+    } else {
+        m_error = QStringLiteral("Ожидался массив событий");
+        return false;
+    }
+
+    skipWs();
+    if (!atEnd())
+        return fail(QStringLiteral("лишние данные после документа"));
+    return true;
+}
+
+// m_p стоит на '['
+bool Scanner::parseEvents(QVector<Event> &out, int *missingIds)
+{
+    ++m_p;
+    skipWs();
+    if (!atEnd() && *m_p == ']') {
+        ++m_p;
+        return true;
+    }
+
+    for (;;) {
+        skipWs();
+        if (!atEnd() && *m_p == '{') {
+            Event e;
+            if (!parseEvent(e))
+                return false;
+            if (missingIds && m_fields.testFlag(EventScanner::Id) && e.id.isNull())
+                ++*missingIds;
+            out.append(e);
+        } else if (!skipValue()) {
+            return false;
+        }
+        skipWs();
+        if (!atEnd() && *m_p == ',') { ++m_p; continue; }
+        return expect(']', "ожидалось ',' или ']'");
+    }
+}
+
+// m_p стоит на '{'
+bool Scanner::parseEvent(Event &e)
+{
+    ++m_p;
+    skipWs();
+    if (!atEnd() && *m_p == '}') {
+        ++m_p;
+        return true;
+    }
+
+    for (;;) {
+        skipWs();
+        Slice key;
+        if (atEnd() || *m_p != '"')
+            return fail(QStringLiteral("ожидался ключ"));
+        if (!readString(key) || !expect(':', "ожидалось ':'"))
+            return false;
+        skipWs();
+
+        EventScanner::Field field = EventScanner::Field(0);
+        if (key.equals("id", 2))                field = EventScanner::Id;
+        else if (key.equals("title", 5))        field = EventScanner::Title;
+        else if (key.equals("start", 5))        field = EventScanner::Start;
+        else if (key.equals("end", 3))          field = EventScanner::End;
+        else if (key.equals("tag", 3))          field = EventScanner::Tag;
+        else if (key.equals("description", 11)) field = EventScanner::Description;
+
+        const bool wanted = field != 0 && m_fields.testFlag(field);
+        if (wanted && !atEnd() && *m_p == '"') {
+            Slice value;
+            if (!readString(value))
+                return false;
+            QString text;
+            switch (field) {
+            case EventScanner::Id:
+                // Как и QJsonValue::toString + QUuid::fromString: мусор даёт пустой id
+                if (!value.escaped)
+                    e.id = QUuid::fromString(QLatin1String(value.begin, value.size()));
+                else if (decode(value, text))
+                    e.id = QUuid::fromString(text);
+                break;
+            case EventScanner::Start:
+                e.start = decodeTime(value);
+                break;
+            case EventScanner::End:
+                e.end = decodeTime(value);
+                break;
+            default:
+                if (!decode(value, text))
+                    return fail(QStringLiteral("некорректная escape-последовательность"));
+                if (field == EventScanner::Title)
+                    e.title = text;
+                else if (field == EventScanner::Tag)
+                    e.tag = text;
+                else
+                    e.description = text;
+                break;
+            }
+        } else if (wanted) {
+            // Не строка: как QJsonValue::toString — поле остаётся пустым
+            switch (field) {
+            case EventScanner::Id:          e.id = QUuid(); break;
+            case EventScanner::Title:       e.title.clear(); break;
+            case EventScanner::Start:       e.start = QTime(); break;
+            case EventScanner::End:         e.end = QTime(); break;
+            case EventScanner::Tag:         e.tag.clear(); break;
+            case EventScanner::Description: e.description.clear(); break;
+            default: break;
+            }
+            if (!skipValue())
+                return false;
+        } else if (!skipValue()) {
+            return false;
+        }
+
+        skipWs();
+        if (!atEnd() && *m_p == ',') { ++m_p; continue; }
+        return expect('}', "ожидалось ',' или '}'");
+    }
+}
+
+bool Scanner::decode(const Slice &slice, QString &value)
+{
+    if (!slice.escaped) {
+        value = QString::fromUtf8(slice.begin, slice.size());
+        return true;
+    }
+
+    // Экранирования — ASCII, поэтому UTF-8 между ними можно раскодировать кусками
+    value.clear();
+    value.reserve(slice.size());
+    const char *run = slice.begin;
+    const char *p = slice.begin;
+    while (p < slice.end) {
+        if (*p != '\\') {
+            ++p;
+            continue;
+        }
+        value += QString::fromUtf8(run, int(p - run));
+        ++p;
+        switch (*p) {
+        case '"':  value += QLatin1Char('"'); break;
+        case '\\': value += QLatin1Char('\\'); break;
+        case '/':  value += QLatin1Char('/'); break;
+        case 'b':  value += QLatin1Char('\b'); break;
+        case 'f':  value += QLatin1Char('\f'); break;
+        case 'n':  value += QLatin1Char('\n'); break;
+        case 'r':  value += QLatin1Char('\r'); break;
+        case 't':  value += QLatin1Char('\t'); break;
+        case 'u': {
+            if (slice.end - p < 5)
+                return false;
+            int code = 0;
+            for (int i = 1; i <= 4; ++i) {
+                const int digit = hexValue(p[i]);
+                if (digit < 0)
+                    return false;
+                code = code * 16 + digit;
+            }
+            // Суррогатные пары складываются сами: QString хранит UTF-16
+            value += QChar(ushort(code));
+            p += 4;
+            break;
+        }
+        default:
+            return false;
+        }
+        ++p;
+        run = p;
+    }
+    value += QString::fromUtf8(run, int(slice.end - run));
+    return true;
+}
+
+QTime Scanner::decodeTime(const Slice &slice)
+{
+    // Быстрый путь для того, что пишет serializeDay: ровно "HH:mm"
+    const char *s = slice.begin;
+    if (!slice.escaped && slice.size() == 5 && s[2] == ':'
+        && s[0] >= '0' && s[0] <= '9' && s[1] >= '0' && s[1] <= '9'
+        && s[3] >= '0' && s[3] <= '9' && s[4] >= '0' && s[4] <= '9') {
+        const int h = (s[0] - '0') * 10 + (s[1] - '0');
+        const int m = (s[3] - '0') * 10 + (s[4] - '0');
+        return (h < 24 && m < 60) ? QTime(h, m) : QTime();
+    }
+
+    // Остальное — как в EventJson::fromJson
+    QString text;
+    if (!decode(slice, text))
+        return QTime();
+    return QTime::fromString(text, QStringLiteral("HH:mm"));
+}
+
+} // namespace
+
+bool EventScanner::parseDay(const QByteArray &data, QVector<Event> &out, Fields fields,
+                            int *missingIds, QString *errorString)
+{
+    TRACE_SCOPE("EventScanner::parseDay");
+    Trace::count(Trace::BytesParsed, data.size());
+    out.clear();
+    if (missingIds) *missingIds = 0;
+
+    Scanner scanner(data, fields);
+    if (!scanner.parse(out, missingIds)) {
+        out.clear();
+        if (errorString) *errorString = scanner.error();
+        return false;
+    }
+    return true;
+}
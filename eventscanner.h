@@ -0,0 +1,44 @@
+#ifndef EVENTSCANNER_H
+#define EVENTSCANNER_H
+
+#include <QByteArray>
+#include <QFlags>
+#include <QString>
+#include <QVector>
+#include "event.h"
+
+// Потоковый разбор файла дня без дерева QJsonDocument. Идёт по байтам
+// один раз и достаёт только запрошенные поля: остальные значения (и
+// вложенные объекты/массивы) пропускаются без копирования. Поиск кавычек,
+// обратных слэшей и скобок — блоками по 16 байт (SSE2), если он доступен.
+//
+// Форматы те же, что у EventJson::parseDay: массив верхнего уровня или
+// объект с массивом "events"; элементы-не-объекты пропускаются.
+// Проверяется структура (скобки, строки, запятые, двоеточия); числа и
+// литералы не разбираются — их значения событиям не нужны.
+class EventScanner
+{
+public:
+    enum Field {
+        Id          = 0x01,
+        Title       = 0x02,
+        Start       = 0x04,
+        End         = 0x08,
+        Tag         = 0x10,
+        Description = 0x20,
+
+        AllFields   = 0x3f,
+        // Всё, что нужно для сумм по тегам
+        TimeAndTag  = Start | End | Tag
+    };
+    Q_DECLARE_FLAGS(Fields, Field)
+
+    // Незапрошенные поля событий остаются пустыми. missingIds считается,
+    // только если запрошен Id.
+    static bool parseDay(const QByteArray &data, QVector<Event> &out, Fields fields = AllFields,
+                         int *missingIds = nullptr, QString *errorString = nullptr);
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(EventScanner::Fields)
+
+#endif // EVENTSCANNER_H
@@ -1,51 +1,191 @@
 #include "histogramwidget.h"
+#include "trace.h"
 #include <QPainter>
 #include <QFontMetrics>
+#include <QMouseEvent>
+#include <QToolTip>
 #include <algorithm>
+#include <utility>
+
+namespace {
+
+const int kMargin = 30;
+const int kSpacing = 6;
+const int kMinBarWidth = 18;    // уже — столбцы сводятся в «Другое»
+const int kMaxBars = 12;
+
+} // namespace
 
 HistogramWidget::HistogramWidget(QWidget *parent)
     : QWidget(parent)
 {
+    setMouseTracking(true);
+    setMinimumSize(240, 160);
 }
 
 void HistogramWidget::setData(const QMap<QString, int> &data)
 {
-    timeByTag = data;
+    TRACE_SCOPE_CAT("HistogramWidget::setData", "ui");
+    m_sorted.clear();
+    m_sorted.reserve(data.size());
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        if (it.value() > 0)
+            m_sorted.append(qMakePair(it.key(), it.value()));
+    }
+    std::stable_sort(m_sorted.begin(), m_sorted.end(),
+                     [](const QPair<QString, int> &a, const QPair<QString, int> &b) {
+                         return a.second > b.second;
+                     });
+
+    m_tailMinutes.fill(0, m_sorted.size() + 1);
+    for (int i = m_sorted.size() - 1; i >= 0; --i)
+        m_tailMinutes[i] = m_tailMinutes[i + 1] + m_sorted.at(i).second;
+    m_totalMinutes = m_tailMinutes.first();
+
+    m_cacheValid = false;
+    m_hovered = -1;
     update();
 }
 
-void HistogramWidget::paintEvent(QPaintEvent *event)
+void HistogramWidget::resizeEvent(QResizeEvent *event)
 {
-    Q_UNUSED(event);
-    QPainter painter(this);
+    QWidget::resizeEvent(event);
+    m_cacheValid = false;
+    m_hovered = -1;
+}
+
+void HistogramWidget::rebuildCache()
+{
+    TRACE_SCOPE_CAT("HistogramWidget::rebuildCache", "ui");
+    m_bars.clear();
+    const qreal dpr = devicePixelRatioF();
+    m_cache = QPixmap(size() * dpr);
+    m_cache.setDevicePixelRatio(dpr);
+    m_cache.fill(Qt::transparent);
+    m_cacheValid = true;
+
+    QPainter painter(&m_cache);
     painter.setRenderHint(QPainter::Antialiasing);
 
-    if (timeByTag.isEmpty()) {
+    if (m_sorted.isEmpty()) {
         painter.drawText(rect(), Qt::AlignCenter, "Нет данных для отображения");
         return;
     }
 
-    int w = width();
-    int h = height();
-    int margin = 30;
-    int spacing = 15;
-    int count = timeByTag.size();
-    int barWidth = (w - 2 * margin) / count;
+    const int w = width();
+    const int h = height();
+
+    // Сколько столбцов помещается; если не все теги — последний место отдаём «Другому»
+    const int fit = qMax(1, (w - 2 * kMargin) / (kMinBarWidth + kSpacing));
+    const int slots = qMin(fit, kMaxBars);
+    const int shown = (m_sorted.size() <= slots) ? m_sorted.size() : qMax(1, slots - 1);
+
+    for (int i = 0; i < shown; ++i) {
+        Bar bar;
+        bar.label = m_sorted.at(i).first;
+        bar.minutes = m_sorted.at(i).second;
+        m_bars.append(bar);
+    }
+    if (shown < m_sorted.size()) {
+        Bar other;
+        other.label = QStringLiteral("Другое");
+        other.minutes = int(m_tailMinutes.at(shown));
+        other.groupedTags = m_sorted.size() - shown;
+        m_bars.append(other);
+    }
 
-    int maxValue = std::max_element(timeByTag.begin(), timeByTag.end()).value();
+    int maxValue = 1;
+    for (const Bar &bar : std::as_const(m_bars))
+        maxValue = qMax(maxValue, bar.minutes);
 
-    int i = 0;
-    for (auto it = timeByTag.constBegin(); it != timeByTag.constEnd(); ++it, ++i) {
-        int value = it.value();
-        int barHeight = static_cast<int>((double)value / maxValue * (h - 2 * margin));
+    const QFontMetrics fm(font());
+    const int slotWidth = (w - 2 * kMargin) / m_bars.size();
+    const int barWidth = qMax(1, slotWidth - kSpacing);
+    const int chartHeight = qMax(1, h - 2 * kMargin);
 
-        QRect barRect(margin + i * barWidth, h - margin - barHeight, barWidth - spacing, barHeight);
-        painter.setBrush(Qt::darkCyan);
-        painter.drawRect(barRect);
+    for (int i = 0; i < m_bars.size(); ++i) {
+        Bar &bar = m_bars[i];
+        const int barHeight = static_cast<int>(double(bar.minutes) / maxValue * chartHeight);
+        bar.rect = QRect(kMargin + i * slotWidth, h - kMargin - barHeight, barWidth, barHeight);
 
-        painter.drawText(barRect.x(), h - margin + 15, it.key());
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(bar.groupedTags > 0 ? QColor(Qt::gray) : QColor(Qt::darkCyan));
+        painter.drawRect(bar.rect);
 
-        QString valueStr = QString::number(value) + " мин";
-        painter.drawText(barRect.x(), barRect.y() - 5, valueStr);
+        // Подписи обрезаются по ширине столбца — длинные теги не налезают друг на друга
+        painter.setPen(palette().color(QPalette::WindowText));
+        const QString label = fm.elidedText(bar.label, Qt::ElideRight, slotWidth);
+        painter.drawText(QRect(bar.rect.x(), h - kMargin + 2, slotWidth, fm.height()),
+                         Qt::AlignLeft | Qt::AlignTop, label);
+
+        const QString valueStr = fm.elidedText(QString::number(bar.minutes) + " мин",
+                                               Qt::ElideRight, slotWidth);
+        painter.drawText(bar.rect.x(), bar.rect.y() - 5, valueStr);
+    }
+}
+
+void HistogramWidget::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    if (!m_cacheValid)
+        rebuildCache();
+
+    QPainter painter(this);
+    painter.drawPixmap(0, 0, m_cache);
+
+    if (m_hovered >= 0 && m_hovered < m_bars.size()) {
+        painter.setPen(QPen(palette().color(QPalette::Highlight), 2));
+        painter.setBrush(Qt::NoBrush);
+        painter.drawRect(m_bars.at(m_hovered).rect.adjusted(-1, -1, 1, 1));
+    }
+}
+
+int HistogramWidget::barAt(const QPoint &pos) const
+{
+    // По горизонтали — весь слот столбца по высоте графика: низкие столбцы тоже ловятся
+    for (int i = 0; i < m_bars.size(); ++i) {
+        const QRect &r = m_bars.at(i).rect;
+        if (pos.x() >= r.left() && pos.x() <= r.right()
+            && pos.y() >= kMargin && pos.y() <= height() - kMargin)
+            return i;
+    }
+    return -1;
+}
+
+void HistogramWidget::mouseMoveEvent(QMouseEvent *event)
+{
+    if (!m_cacheValid)
+        return;     // геометрия ещё не посчитана — после отрисовки будет
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    const QPoint pos = event->position().toPoint();
+#else
+    const QPoint pos = event->pos();
+#endif
+    const int hovered = barAt(pos);
+    if (hovered != m_hovered) {
+        m_hovered = hovered;
+        update();
+    }
+
+    if (hovered < 0) {
+        QToolTip::hideText();
+        return;
+    }
+    const Bar &bar = m_bars.at(hovered);
+    const double percent = m_totalMinutes > 0 ? bar.minutes * 100.0 / m_totalMinutes : 0.0;
+    QString text = QStringLiteral("%1: %2 мин (%3%)")
+                       .arg(bar.label).arg(bar.minutes).arg(percent, 0, 'f', 1);
+    if (bar.groupedTags > 0)
+        text += QStringLiteral("\nтегов: %1").arg(bar.groupedTags);
+    QToolTip::showText(mapToGlobal(pos), text, this);
+}
+
+void HistogramWidget::leaveEvent(QEvent *event)
+{
+    QWidget::leaveEvent(event);
+    if (m_hovered >= 0) {
+        m_hovered = -1;
+        update();
     }
 }
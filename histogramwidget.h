@@ -3,8 +3,15 @@
 
 #include <QWidget>
 #include <QMap>
+#include <QPixmap>
 #include <QString>
+#include <QVector>
 
+// Гистограмма минут по тегам. Столбцы — по убыванию; если тегов больше,
+// чем помещается (или больше kMaxBars), хвост сводится в один столбец «Другое».
+// Разметка и надписи рисуются один раз в QPixmap и пересчитываются только
+// при setData() или изменении размера; paintEvent лишь копирует картинку
+// и подсвечивает столбец под курсором (по запомненной геометрии).
 class HistogramWidget : public QWidget
 {
     Q_OBJECT
@@ -14,9 +21,31 @@ public:
 
 protected:
     void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void leaveEvent(QEvent *event) override;
 
 private:
-    QMap<QString, int> timeByTag;
+    struct Bar {
+        QString label;
+        int minutes = 0;
+        int groupedTags = 0;    // > 0 — столбец «Другое»: сколько тегов в него вошло
+        QRect rect;             // геометрия столбца в координатах виджета
+    };
+
+    // Все теги по убыванию минут и суффиксные суммы для «Другого» (считаются в setData)
+    QVector<QPair<QString, int>> m_sorted;
+    QVector<qint64> m_tailMinutes;      // m_tailMinutes[i] — сумма минут тегов [i, end)
+    qint64 m_totalMinutes = 0;
+
+    // Кэш отрисовки
+    QVector<Bar> m_bars;
+    QPixmap m_cache;
+    bool m_cacheValid = false;
+    int m_hovered = -1;
+
+    void rebuildCache();
+    int barAt(const QPoint &pos) const;
 };
 
 #endif // HISTOGRAMWIDGET_H
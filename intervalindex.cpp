@@ -0,0 +1,133 @@
+#include "intervalindex.h"
+
+#include <algorithm>
+
+namespace {
+
+const int kDayMinutes = 24 * 60;
+
+int minuteOf(const QTime &t)
+{
+    return t.hour() * 60 + t.minute();
+}
+
+} // namespace
+
+IntervalIndex::IntervalIndex(const QVector<Event> &events)
+{
+    m_ids.reserve(events.size());
+    m_intervals.reserve(events.size());
+    for (int i = 0; i < events.size(); ++i) {
+        const Event &e = events.at(i);
+        m_ids.append(e.id);
+        if (!e.start.isValid() || !e.end.isValid())
+            continue;
+
+        const int start = minuteOf(e.start);
+        const int end = minuteOf(e.end);
+        if (start < end) {
+            m_intervals.append({ start, end, i });
+        } else if (end < start) {
+            m_intervals.append({ start, kDayMinutes, i });
+            if (end > 0)
+                m_intervals.append({ 0, end, i });
+        }
+    }
+
+    std::sort(m_intervals.begin(), m_intervals.end(), [](const Interval &a, const Interval &b) {
+        return a.start < b.start;
+    });
+
+    if (!m_intervals.isEmpty()) {
+        m_maxEnd.fill(0, 4 * m_intervals.size());
+        build(1, 0, m_intervals.size() - 1);
+    }
+}
+
+void IntervalIndex::build(int node, int lo, int hi)
+{
+    if (lo == hi) {
+        m_maxEnd[node] = m_intervals.at(lo).end;
+        return;
+    }
+    const int mid = (lo + hi) / 2;
+    build(2 * node, lo, mid);
+    build(2 * node + 1, mid + 1, hi);
+    m_maxEnd[node] = qMax(m_maxEnd.at(2 * node), m_maxEnd.at(2 * node + 1));
+}
+
+void IntervalIndex::collect(int node, int lo, int hi, int limit, int from, QVector<int> &out) const
+{
+    if (lo >= limit || m_maxEnd.at(node) <= from)
+        return;     // всё поддерево начинается слишком поздно или кончается слишком рано
+    if (lo == hi) {
+        out.append(lo);
+        return;
+    }
+    const int mid = (lo + hi) / 2;
+    collect(2 * node, lo, mid, limit, from, out);
+    collect(2 * node + 1, mid + 1, hi, limit, from, out);
+}
+
+QVector<int> IntervalIndex::intervalsOverlapping(int from, int to, const QUuid &ignoreId) const
+{
+    QVector<int> found;
+    if (m_intervals.isEmpty() || from >= to)
+        return found;
+
+    // Кандидаты — интервалы, начавшиеся раньше конца искомого
+    const int limit = int(std::lower_bound(m_intervals.cbegin(), m_intervals.cend(), to,
+                                           [](const Interval &iv, int value) { return iv.start < value; })
+                          - m_intervals.cbegin());
+    collect(1, 0, m_intervals.size() - 1, limit, from, found);
+
+    if (!ignoreId.isNull()) {
+        found.erase(std::remove_if(found.begin(), found.end(), [&](int i) {
+                        return m_ids.at(m_intervals.at(i).event) == ignoreId;
+                    }),
+                    found.end());
+    }
+    return found;
+}
+
+QVector<int> IntervalIndex::overlapping(const QTime &start, const QTime &end,
+                                        const QUuid &ignoreId) const
+{
+    QVector<int> events;
+    if (!start.isValid() || !end.isValid())
+        return events;
+
+    const int s = minuteOf(start);
+    const int e = minuteOf(end);
+    QVector<int> hits;
+    if (s < e) {
+        hits = intervalsOverlapping(s, e, ignoreId);
+    } else if (e < s) {
+        hits = intervalsOverlapping(s, kDayMinutes, ignoreId);
+        hits += intervalsOverlapping(0, e, ignoreId);
+    }
+
+    events.reserve(hits.size());
+    for (int i : hits)
+        events.append(m_intervals.at(i).event);
+    std::sort(events.begin(), events.end());
+    events.erase(std::unique(events.begin(), events.end()), events.end());
+    return events;
+}
+
+int IntervalIndex::nextFreeStart(int start, int length, const QUuid &ignoreId) const
+{
+    if (length <= 0)
+        return -1;
+
+    // Каждый шаг переносит начало за конец самого позднего мешающего интервала
+    int candidate = qMax(0, start);
+    while (candidate + length <= kDayMinutes) {
+        const QVector<int> hits = intervalsOverlapping(candidate, candidate + length, ignoreId);
+        if (hits.isEmpty())
+            return candidate;
+        for (int i : hits)
+            candidate = qMax(candidate, m_intervals.at(i).end);
+    }
+    return -1;
+}
@@ -0,0 +1,50 @@
+#ifndef INTERVALINDEX_H
+#define INTERVALINDEX_H
+
+#include <QTime>
+#include <QUuid>
+#include <QVector>
+#include "event.h"
+
+// Индекс интервалов событий одного дня для поиска наложений.
+// Интервалы [start, end) в минутах от полуночи отсортированы по началу,
+// над ними — дерево отрезков с максимумом концов: запрос отсекает
+// поддеревья, где все интервалы кончаются раньше, чем начинается искомый,
+// поэтому стоит O(log n + k), а не проход по всем событиям дня.
+// Событие через полночь (end < start) — два интервала: [start, 24:00) и [0, end).
+class IntervalIndex
+{
+public:
+    IntervalIndex() = default;
+    explicit IntervalIndex(const QVector<Event> &events);
+
+    // Номера событий (в исходном векторе), пересекающихся с [start, end);
+    // без повторов, по возрастанию. ignoreId — само редактируемое событие.
+    QVector<int> overlapping(const QTime &start, const QTime &end,
+                             const QUuid &ignoreId = QUuid()) const;
+
+    // Ближайшее начало не раньше start, с которого length минут свободны
+    // (в пределах дня, без перехода через полночь); -1 — места нет
+    int nextFreeStart(int start, int length, const QUuid &ignoreId = QUuid()) const;
+
+    bool isEmpty() const { return m_intervals.isEmpty(); }
+
+private:
+    struct Interval {
+        int start;
+        int end;
+        int event;      // номер события в исходном векторе
+    };
+
+    QVector<Interval> m_intervals;  // по возрастанию start
+    QVector<int> m_maxEnd;          // дерево отрезков: узел 1 — корень, дети 2i и 2i+1
+    QVector<QUuid> m_ids;           // id событий по номеру
+
+    void build(int node, int lo, int hi);
+    // Интервалы из [lo, hi] c номером < limit и концом > from
+    void collect(int node, int lo, int hi, int limit, int from, QVector<int> &out) const;
+    // Номера интервалов, пересекающихся с [from, to), 0 <= from < to <= 24:00
+    QVector<int> intervalsOverlapping(int from, int to, const QUuid &ignoreId) const;
+};
+
+#endif // INTERVALINDEX_H
@@ -1,12 +1,63 @@
 #include "mainwindow.h"
 #include "event.h"
+#include "analysiscli.h"
+#include "trace.h"
 #include <QApplication>
+#include <QCoreApplication>
+#include <QtGlobal>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <cstdio>
+#endif
+
+namespace {
+
+#ifdef Q_OS_WIN
+// Под Windows окно собирается как GUI-приложение (WIN32_EXECUTABLE) и
+// стартует без консоли: для отчёта подключаемся к консоли, из которой нас
+// запустили. Потоки, перенаправленные в файл или канал, уже рабочие — их
+// не трогаем
+void attachParentConsole()
+{
+    const bool outRedirected = GetFileType(GetStdHandle(STD_OUTPUT_HANDLE)) != FILE_TYPE_UNKNOWN;
+    const bool errRedirected = GetFileType(GetStdHandle(STD_ERROR_HANDLE)) != FILE_TYPE_UNKNOWN;
+    if (!AttachConsole(ATTACH_PARENT_PROCESS))
+        return;     // запуск не из консоли (ярлык, проводник)
+
+    FILE *stream = nullptr;
+    if (!outRedirected)
+        freopen_s(&stream, "CONOUT$", "w", stdout);
+    if (!errRedirected)
+        freopen_s(&stream, "CONOUT$", "w", stderr);
+}
+#endif
+
+} // namespace
 
 int main(int argc, char *argv[])
 {
-    QApplication a(argc, argv);
-    qRegisterMetaType<Event>("Event");
-    MainWindow w;
-    w.show();
-    return a.exec();
+    // Трассировка: --trace файл.json или TIMETRACKER_TRACE=файл.json
+    Trace::configure(argc, argv);
+
+    int code = 0;
+    if (AnalysisCli::isRequested(argc, argv)) {
+        // Отчёт из командной строки: без QApplication и виджетов (работает и без дисплея)
+#ifdef Q_OS_WIN
+        attachParentConsole();
+#endif
+        QCoreApplication app(argc, argv);
+        code = AnalysisCli::run(app.arguments());
+    } else {
+        QApplication a(argc, argv);
+        qRegisterMetaType<Event>("Event");
+        MainWindow w;
+        w.show();
+        code = a.exec();
+    }   // окно закрыто и очередь записи дописана — в трассу попадает и выход
+
+    QString traceError;
+    if (!Trace::finish(&traceError))
+        qWarning("%s", qPrintable(traceError));
+    return code;
 }
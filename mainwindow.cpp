@@ -2,36 +2,32 @@
 #include "ui_mainwindow.h"
 #include "eventdialog.h"
 #include "analysisdialog.h"
-
-#include <QListWidgetItem>
+#include "timeseriesdialog.h"
+#include "eventlistmodel.h"
+#include "daywriter.h"
+#include "datadirwatcher.h"
+#include "eventimporter.h"
+
+#include <QColor>
+#include <QFileDialog>
+#include <QFont>
+#include <QListWidget>
 #include <QMessageBox>
-#include <QFile>
-#include <QFileInfo>
-#include <QDir>
-#include <QSaveFile>
-#include <QStandardPaths>
-#include <QJsonDocument>
-#include <QJsonArray>
-#include <QJsonObject>
+#include <QPointer>
+#include <QStatusBar>
+#include <QTextCharFormat>
+#include <QTimer>
 #include <QUuid>
-#include <QCoreApplication>   // ✅ добавлено для applicationDirPath()
-#include <algorithm>
+#include <QFutureWatcher>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <functional>
+#include <utility>
 
 namespace {
 
-// Папка для хранения данных приложения.
-// ✅ Теперь — локальная ./data рядом с исполняемым файлом.
-static QString appDataDir()
-{
-    const QString base = QCoreApplication::applicationDirPath() + "/data";
-    QDir().mkpath(base);  // гарантируем наличие папки
-    return base;
-}
-
-static QString eventsFileForDate(const QDate& date)
-{
-    return appDataDir() + "/" + date.toString("yyyy-MM-dd") + ".json";
-}
+// Совпадений на год, не больше: короткие запросы находят почти всё
+const int kMaxSearchHitsPerYear = 500;
 
 } // namespace
 
@@ -41,6 +37,67 @@ MainWindow::MainWindow(QWidget *parent)
     ui->setupUi(this);
     currentDate = ui->calendarWidget->selectedDate();
 
+    m_model = new EventListModel(this);
+    ui->listViewEvents->setModel(m_model);
+
+    m_writer = new DayWriter(m_store, this);
+    connect(m_writer, &DayWriter::written, this, &MainWindow::onDayWritten);
+    connect(m_writer, &DayWriter::failed, this, &MainWindow::onDayWriteFailed);
+
+    m_watcher = new DataDirWatcher(m_store.dataDir(), this);
+    connect(m_watcher, &DataDirWatcher::daysChanged, this, &MainWindow::onDaysChangedOnDisk);
+
+    // Оглавление дней: чтение (при необходимости — сверка с каталогом) в фоне
+    m_manifest = new DayManifest(m_store.dataDir());
+    auto *opening = new QFutureWatcher<void>(this);
+    connect(opening, &QFutureWatcher<void>::finished, this, [this, opening]() {
+        opening->deleteLater();
+        onManifestReady();
+    });
+    DayManifest *manifest = m_manifest;
+    opening->setFuture(QtConcurrent::run([manifest]() {
+        manifest->open();
+    }));
+    // Записи идут пачками — оглавление сохраняется после паузы и при выходе
+    m_manifestSaveTimer = new QTimer(this);
+    m_manifestSaveTimer->setSingleShot(true);
+    m_manifestSaveTimer->setInterval(2000);
+    connect(m_manifestSaveTimer, &QTimer::timeout, this, [this]() {
+        m_manifest->save();
+    });
+    connect(ui->calendarWidget, &QCalendarWidget::currentPageChanged,
+            this, &MainWindow::highlightCalendar);
+
+    // Индекс поиска: чтение с диска и досборка по изменившимся дням — в фоне
+    m_search = new SearchIndex(m_store.dataDir());
+    auto *indexing = new QFutureWatcher<void>(this);
+    connect(indexing, &QFutureWatcher<void>::finished, this, [this, indexing]() {
+        indexing->deleteLater();
+        if (!ui->lineEditSearch->text().trimmed().isEmpty())
+            startSearch();      // запрос набрали, пока индекс собирался
+    });
+    SearchIndex *index = m_search;
+    indexing->setFuture(QtConcurrent::run([index]() {
+        index->load();
+        index->refreshAll();
+        index->save();
+    }));
+
+    m_searchTimer = new QTimer(this);
+    m_searchTimer->setSingleShot(true);
+    m_searchTimer->setInterval(150);
+    m_searchWatcher = new QFutureWatcher<QVector<SearchIndex::Hit>>(this);
+    ui->listWidgetSearch->hide();
+    connect(ui->lineEditSearch, &QLineEdit::textChanged, m_searchTimer,
+            static_cast<void (QTimer::*)()>(&QTimer::start));
+    connect(m_searchTimer, &QTimer::timeout, this, &MainWindow::startSearch);
+    connect(m_searchWatcher, &QFutureWatcher<QVector<SearchIndex::Hit>>::resultReadyAt,
+            this, &MainWindow::onSearchResultReady);
+    connect(m_searchWatcher, &QFutureWatcher<QVector<SearchIndex::Hit>>::finished,
+            this, &MainWindow::onSearchFinished);
+    connect(ui->listWidgetSearch, &QListWidget::itemActivated,
+            this, &MainWindow::onSearchItemActivated);
+
     // Инициализация «пасхального режима» и подписка на чекбокс
     m_easterEnabled = ui->esteggcheckBox->isChecked();
     connect(ui->esteggcheckBox, &QCheckBox::toggled, this, [this](bool on){
@@ -56,12 +113,27 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->pushButtonEdit,    &QPushButton::clicked, this, &MainWindow::onEditEventClicked);
     connect(ui->pushButtonDelete,  &QPushButton::clicked, this, &MainWindow::onDeleteEventClicked);
     connect(ui->pushButtonAnalyze, &QPushButton::clicked, this, &MainWindow::onAnalyzeClicked);
+    connect(ui->pushButtonTimeline, &QPushButton::clicked, this, &MainWindow::onTimelineClicked);
+    connect(ui->pushButtonImport, &QPushButton::clicked, this, &MainWindow::onImportClicked);
 
     onDateChanged(currentDate); // стартовая загрузка
 }
 
 MainWindow::~MainWindow()
 {
+    // Всё, что стоит в очереди записи, должно попасть на диск до выхода
+    m_writer->flush();
+    delete m_writer;
+    delete m_watcher;
+    // Фоновые загрузки дней держат указатель на окно через свои watcher'ы,
+    // индексация и поиск — указатель на индекс
+    m_searchWatcher->cancel();
+    QThreadPool::globalInstance()->waitForDone();
+    // Дни, записанные при выходе, индекс подхватит при следующем запуске
+    m_search->save();
+    delete m_search;
+    m_manifest->save();
+    delete m_manifest;
     delete ui;
 }
 
@@ -69,6 +141,8 @@ void MainWindow::onAddEventClicked()
 {
     EventDialog dialog(this);
     dialog.setEasterEnabled(m_easterEnabled);      // ✅ прокидываем состояние пасхального режима
+    if (const QVector<Event> *events = m_days.peek(currentDate))
+        dialog.setDayEvents(*events);              // для проверки наложений
 
     if (dialog.exec() == QDialog::Accepted) {
         Event e;
@@ -79,29 +153,31 @@ void MainWindow::onAddEventClicked()
         e.tag = dialog.getTag();
         e.description = dialog.getDescription();
 
-        eventsByDate[currentDate].append(e);
-        saveEventsForDate(currentDate);
-        rebuildEventList();
+        if (!m_days.append(currentDate, e)) return;
+        journalEvent(currentDate, DayStore::JournalOp::Add, e);
+        selectRow(m_model->insertEvent(e));
     }
 }
 
 void MainWindow::onEditEventClicked()
 {
-    QListWidgetItem *item = ui->listWidgetEvents->currentItem();
-    if (!item) {
+    const QModelIndex item = ui->listViewEvents->currentIndex();
+    if (!item.isValid()) {
         QMessageBox::warning(this, "Нет выбора", "Выберите событие для редактирования.");
         return;
     }
 
-    // ✅ Получаем id из выбранного элемента списка
-    const QUuid id = QUuid::fromString(item->data(Qt::UserRole).toString());
+    // ✅ Получаем id из выбранной строки списка
+    const QUuid id = item.data(EventListModel::IdRole).value<QUuid>();
     if (id.isNull()) return;
 
     int index = findEventIndexById(id);
-    if (index < 0 || index >= eventsByDate[currentDate].size())
+    const QVector<Event> *events = m_days.peek(currentDate);
+    if (!events || index < 0 || index >= events->size())
         return;
 
-    Event &e = eventsByDate[currentDate][index];
+    // Работаем с копией: пока открыт диалог, фоновые загрузки меняют кэш дней
+    Event e = events->at(index);
     EventDialog dialog(this);
     dialog.setEasterEnabled(m_easterEnabled);      // ✅ пасхальный режим в диалог
     dialog.setWindowTitle("Редактирование события");
@@ -110,6 +186,7 @@ void MainWindow::onEditEventClicked()
     dialog.setEndTime(e.end);
     dialog.setTag(e.tag);
     dialog.setDescription(e.description);
+    dialog.setDayEvents(*events, e.id);            // наложения — без самого события
 
     if (dialog.exec() == QDialog::Accepted) {
         // Сохраняем тот же id
@@ -119,173 +196,539 @@ void MainWindow::onEditEventClicked()
         e.tag = dialog.getTag();
         e.description = dialog.getDescription();
 
-        saveEventsForDate(currentDate);
-        rebuildEventList();
+        const QVector<Event> *current = m_days.peek(currentDate);
+        index = findEventIndexById(id);
+        if (!current || index < 0)
+            return;
+        const Event before = current->at(index);
+        m_days.replace(currentDate, index, e);
+        journalEvent(currentDate, DayStore::JournalOp::Update, e);
+        selectRow(m_model->updateEvent(before, e));
     }
 }
 
 void MainWindow::onDeleteEventClicked()
 {
-    QListWidgetItem *item = ui->listWidgetEvents->currentItem();
-    if (!item) {
+    const QModelIndex item = ui->listViewEvents->currentIndex();
+    if (!item.isValid()) {
         QMessageBox::warning(this, "Нет выбора", "Выберите событие для удаления.");
         return;
     }
 
     // ✅ Удаляем по id
-    const QUuid id = QUuid::fromString(item->data(Qt::UserRole).toString());
+    const QUuid id = item.data(EventListModel::IdRole).value<QUuid>();
     if (id.isNull()) return;
 
-    int index = findEventIndexById(id);
-    if (index >= 0 && index < eventsByDate[currentDate].size()) {
-        eventsByDate[currentDate].removeAt(index);
-        saveEventsForDate(currentDate);
-        rebuildEventList();
+    Event removed;
+    if (m_days.removeAt(currentDate, findEventIndexById(id), &removed)) {
+        journalEvent(currentDate, DayStore::JournalOp::Delete, removed);
+        m_model->removeEvent(removed);
     }
 }
 
 void MainWindow::onDateChanged(const QDate &date)
 {
     currentDate = date;
-    loadEventsForDate(date);
-    rebuildEventList();
+    m_watcher->watchDay(date);
+
+    // День уже в памяти и не менялся на диске — показываем сразу, без чтения файла
+    if (m_days.find(date) && isDayFresh(date)) {
+        rebuildEventList();
+        setDayActionsEnabled(true);
+    } else {
+        m_model->setEvents(QVector<Event>());
+        setDayActionsEnabled(false);
+        requestDayLoad(date);
+    }
+
+    prefetchAround(date);
 }
 
-void MainWindow::rebuildEventList()
+bool MainWindow::isDayFresh(const QDate &date) const
+{
+    if (!m_days.contains(date))
+        return false;
+    // Незаписанные правки важнее файла на диске
+    return m_days.isDirty(date) || m_days.signature(date) == m_store.signature(date);
+}
+
+void MainWindow::setDayActionsEnabled(bool on)
 {
-    ui->listWidgetEvents->clear();
-    QVector<Event> &events = eventsByDate[currentDate];
+    ui->pushButtonCreate->setEnabled(on);
+    ui->pushButtonEdit->setEnabled(on);
+    ui->pushButtonDelete->setEnabled(on);
+}
+
+void MainWindow::requestDayLoad(const QDate &date)
+{
+    if (m_pendingLoads.contains(date))
+        return;
+    m_pendingLoads.insert(date);
 
-    std::sort(events.begin(), events.end(), [](const Event &a, const Event &b) {
-        // если время невалидно, сортируем по названию, иначе по времени начала
-        if (!a.start.isValid() || !b.start.isValid())
-            return a.title.toLower() < b.title.toLower();
-        return a.start < b.start;
+    auto *watcher = new QFutureWatcher<DayLoad>(this);
+    connect(watcher, &QFutureWatcher<DayLoad>::finished, this, [this, watcher]() {
+        onDayLoaded(watcher->result());
+        watcher->deleteLater();
     });
 
-    for (const Event &e : events) {
-        auto *item = new QListWidgetItem(e.toDisplayString());
-        item->setData(Qt::UserRole, e.id.toString(QUuid::WithoutBraces)); // ✅ храним id в item
-        ui->listWidgetEvents->addItem(item);
+    const DayStore store = m_store;
+    watcher->setFuture(QtConcurrent::run([store, date]() {
+        DayLoad load;
+        load.date = date;
+        load.sig = store.signature(date);   // до чтения — см. DayStore::signature
+        load.ok = store.load(date, load.events, &load.generatedIds, &load.error);
+        return load;
+    }));
+}
+
+void MainWindow::onDayLoaded(const DayLoad &load)
+{
+    m_pendingLoads.remove(load.date);
+    const bool isCurrent = (load.date == currentDate);
+
+    if (!load.ok) {
+        // Ошибки упреждающей загрузки молчим — покажем, если день откроют
+        if (isCurrent) {
+            // Пустой день без подписи: при следующем открытии файл перечитается
+            m_days.insert(load.date, QVector<Event>(), DayStore::Signature());
+            QMessageBox::warning(this, "Ошибка чтения", load.error);
+            rebuildEventList();
+            setDayActionsEnabled(true);
+        }
+        return;
+    }
+
+    // Незаписанные правки дня не затираем; перечитаем день после их записи
+    if (m_days.isDirty(load.date)) {
+        m_changedOnDisk.insert(load.date);
+        return;
+    }
+    m_days.insert(load.date, load.events, load.sig);
+    updateManifest(load.date, load.events, load.sig);
+
+    // Если в файле не было id — пересохраним уже с id
+    if (load.generatedIds)
+        saveEventsForDate(load.date);
+
+    if (isCurrent) {
+        refreshEventList();
+        setDayActionsEnabled(true);
     }
 }
 
-void MainWindow::loadEventsForDate(const QDate &date)
+void MainWindow::onDaysChangedOnDisk(const QList<QDate> &dates)
 {
-    const QString filename = eventsFileForDate(date);
-    QFile file(filename);
+    indexDays(dates);
+    refreshManifestDays(dates);
+
+    for (const QDate &date : dates) {
+        // Дня нет в памяти — при открытии он и так прочитается с диска
+        if (!m_days.contains(date))
+            continue;
+        // Незаписанные правки сначала допишутся (журнал ляжет поверх чужих
+        // правок), а день перечитается в onDayWritten
+        if (m_days.isDirty(date)) {
+            m_changedOnDisk.insert(date);
+            continue;
+        }
+        // Совпадение подписи — это наша же запись
+        if (m_days.signature(date) == m_store.signature(date))
+            continue;
+
+        if (date == currentDate)
+            requestDayLoad(date);   // список обновится точечно в onDayLoaded
+        else
+            m_days.remove(date);
+    }
+}
 
-    eventsByDate[date].clear();
+void MainWindow::prefetchAround(const QDate &date)
+{
+    for (int offset : { 1, -1, 7, -7 }) {
+        const QDate d = date.addDays(offset);
+        if (!m_days.contains(d))
+            requestDayLoad(d);
+    }
+}
 
-    if (!file.exists())
+void MainWindow::rebuildEventList()
+{
+    // Полная пересборка — только при смене/перезагрузке дня; правки идут точечно
+    const QVector<Event> *events = m_days.peek(currentDate);
+    m_model->setEvents(events ? *events : QVector<Event>());
+    selectPendingEvent();
+}
+
+void MainWindow::refreshEventList()
+{
+    const QVector<Event> *events = m_days.peek(currentDate);
+    m_model->syncEvents(events ? *events : QVector<Event>());
+    selectPendingEvent();
+}
+
+void MainWindow::selectPendingEvent()
+{
+    if (m_selectAfterLoad.isNull())
         return;
+    for (int row = 0; row < m_model->rowCount(); ++row) {
+        if (m_model->eventAt(row).id == m_selectAfterLoad) {
+            selectRow(row);
+            ui->listViewEvents->scrollTo(m_model->index(row));
+            break;
+        }
+    }
+    m_selectAfterLoad = QUuid();
+}
 
-    if (!file.open(QIODevice::ReadOnly)) {
-        QMessageBox::warning(this, "Ошибка чтения",
-                             "Не удалось открыть файл: " + filename + "\n" + file.errorString());
+void MainWindow::selectRow(int row)
+{
+    if (row >= 0)
+        ui->listViewEvents->setCurrentIndex(m_model->index(row));
+}
+
+void MainWindow::saveEventsForDate(const QDate &date)
+{
+    if (!m_days.contains(date))
         return;
+
+    // День изменили на диске, пока правки ждали записи: снимок из кэша
+    // затёр бы чужие события — сначала добираем их с диска (путь после
+    // ошибки записи, редкий)
+    if (m_changedOnDisk.contains(date)) {
+        QVector<Event> onDisk;
+        if (m_store.load(date, onDisk)) {
+            for (const Event &e : std::as_const(onDisk)) {
+                if (m_days.indexOf(date, e.id) < 0)
+                    m_days.append(date, e);
+            }
+            if (date == currentDate)
+                refreshEventList();
+        }
     }
+    const QVector<Event> *events = m_days.peek(date);
+
+    // До подтверждения записи день «грязный» и не вытесняется из кэша
+    m_days.markDirty(date);
+    ++m_unconfirmedWrites[date];
+    // Снимок покрывает и правки, запись которых не удалась; если не удастся
+    // и он, день вернётся в m_failedWrites
+    m_failedWrites.remove(date);
+    m_writer->enqueueSave(date, *events);
+}
 
-    const QByteArray data = file.readAll();
-    file.close();
+void MainWindow::journalEvent(const QDate &date, DayStore::JournalOp op, const Event &e)
+{
+    m_days.markDirty(date);
+    ++m_unconfirmedWrites[date];
+    m_writer->enqueueJournal(date, op, e);
+}
 
-    QJsonParseError err{};
-    const QJsonDocument doc = QJsonDocument::fromJson(data, &err);
-    if (err.error != QJsonParseError::NoError) {
-        QMessageBox::warning(this, "Ошибка JSON",
-                             "Некорректный JSON в файле: " + filename + "\n" + err.errorString());
+void MainWindow::onDayWritten(const QDate &date, const DayStore::Signature &sig, int ops)
+{
+    int &left = m_unconfirmedWrites[date];
+    left -= ops;
+    if (left > 0)
+        return;     // есть более поздние правки — ждём и их
+    m_unconfirmedWrites.remove(date);
+
+    // Часть правок дня на диск не попала, а снимка с тех пор не было:
+    // запись снова работает — перезаписываем день целиком
+    if (m_failedWrites.contains(date)) {
+        saveEventsForDate(date);
         return;
     }
-    if (!doc.isArray()) {
-        QMessageBox::warning(this, "Ошибка JSON",
-                             "Ожидался массив событий в файле: " + filename);
+
+    m_days.markClean(date, sig);
+    indexDays({ date });
+
+    // Пока правки ждали записи, день изменили на диске: в кэше его старая
+    // версия — перечитываем (список обновится в onDayLoaded)
+    if (m_changedOnDisk.remove(date)) {
+        if (date == currentDate)
+            requestDayLoad(date);
+        else
+            m_days.remove(date);
+        refreshManifestDays({ date });
         return;
     }
+    if (const QVector<Event> *events = m_days.peek(date))
+        updateManifest(date, *events, sig);
+}
 
-    bool generatedIds = false;
+void MainWindow::onDayWriteFailed(const QDate &date, const QString &error, int ops,
+                                  bool retryAsSnapshot)
+{
+    // День остаётся «грязным»: правки живут в кэше, пока не запишется снимок
+    // дня (onDayWritten не сделает его чистым, пока день в m_failedWrites)
+    int &left = m_unconfirmedWrites[date];
+    left -= ops;
+    if (left <= 0)
+        m_unconfirmedWrites.remove(date);
+    m_failedWrites.insert(date);
+
+    QMessageBox::warning(this, "Ошибка записи", error);
+
+    // Журнал недоступен — пробуем записать день целиком
+    if (retryAsSnapshot)
+        saveEventsForDate(date);
+}
 
-    const QJsonArray arr = doc.array();
-    for (const QJsonValue &val : arr) {
-        const QJsonObject obj = val.toObject();
-        Event e;
+void MainWindow::onAnalyzeClicked()
+{
+    AnalysisDialog dialog(this);
+    dialog.setEasterEnabled(m_easterEnabled);      // ✅ пасхальный режим — в анализ
+    dialog.exec();
+}
 
-        // ✅ обратносовместимая загрузка id
-        const QString idStr = obj.value("id").toString();
-        e.id = QUuid::fromString(idStr);
-        if (!obj.contains("id") || e.id.isNull()) {
-            e.id = QUuid::createUuid();
-            generatedIds = true;
-        }
+void MainWindow::onTimelineClicked()
+{
+    // Те же каталоги, что и у диалога анализа
+    TimeSeriesDialog dialog(TagAnalyzer::defaultDataDirs(), this);
+    dialog.exec();
+}
 
-        e.title = obj.value("title").toString();
-        e.start = QTime::fromString(obj.value("start").toString(), "HH:mm");
-        e.end   = QTime::fromString(obj.value("end").toString(),   "HH:mm");
-        e.tag = obj.value("tag").toString();
-        e.description = obj.value("description").toString();
-        eventsByDate[date].append(e);
+void MainWindow::onManifestReady()
+{
+    m_manifestReady = true;
+    // Дни, записанные или прочитанные, пока оглавление открывалось
+    for (const QDate &date : std::as_const(m_manifestPending)) {
+        if (const QVector<Event> *events = m_days.peek(date))
+            m_manifest->update(date, *events, m_store.signature(date));
     }
+    m_manifestPending.clear();
+    if (m_manifest->isDirty())
+        m_manifestSaveTimer->start();
+    highlightCalendar();
+}
 
-    // Если в файле не было id — пересохраним уже с id
-    if (generatedIds) {
-        saveEventsForDate(date);
+void MainWindow::updateManifest(const QDate &date, const QVector<Event> &events,
+                                const DayStore::Signature &sig)
+{
+    if (!m_manifestReady) {
+        m_manifestPending.insert(date);
+        return;
     }
+    const DayManifest::DayInfo before = m_manifest->info(date);
+    m_manifest->update(date, events, sig);
+    if (!m_manifest->isDirty())
+        return;
+    m_manifestSaveTimer->start();
+
+    const DayManifest::DayInfo after = m_manifest->info(date);
+    if (before.eventCount != after.eventCount || before.minutes != after.minutes)
+        highlightCalendar();
 }
 
-void MainWindow::saveEventsForDate(const QDate &date)
+void MainWindow::refreshManifestDays(const QList<QDate> &dates)
 {
-    const QString filename = eventsFileForDate(date);
-    QDir().mkpath(QFileInfo(filename).absolutePath()); // гарантируем наличие папки
-
-    QJsonArray arr;
-    for (const Event &e : eventsByDate[date]) {
-        QJsonObject obj;
-        obj["id"]    = e.id.toString(QUuid::WithoutBraces);  // ✅ сохраняем id
-        obj["title"] = e.title;
-        obj["start"] = e.start.toString("HH:mm");
-        obj["end"]   = e.end.toString("HH:mm");
-        obj["tag"]   = e.tag;
-        obj["description"] = e.description;
-        arr.append(obj);
+    // До готовности оглавления новые и удалённые дни учтёт сверка при открытии
+    if (!m_manifestReady)
+        return;
+
+    // Свои записи оглавление уже знает — перечитываем только чужие правки
+    QList<QDate> stale;
+    for (const QDate &date : dates) {
+        if (m_manifest->info(date).sig != m_store.signature(date))
+            stale.append(date);
     }
+    if (stale.isEmpty())
+        return;
 
-    QSaveFile file(filename);               // атомарная запись
-    if (!file.open(QIODevice::WriteOnly)) {
-        QMessageBox::warning(this, "Ошибка записи",
-                             "Не удалось открыть файл для записи: " + filename + "\n" + file.errorString());
+    auto *watcher = new QFutureWatcher<QVector<DayLoad>>(this);
+    connect(watcher, &QFutureWatcher<QVector<DayLoad>>::finished, this, [this, watcher]() {
+        const QVector<DayLoad> loads = watcher->result();
+        for (const DayLoad &load : loads) {
+            if (load.ok)
+                updateManifest(load.date, load.events, load.sig);
+        }
+        watcher->deleteLater();
+    });
+
+    const DayStore store = m_store;
+    watcher->setFuture(QtConcurrent::run([store, stale]() {
+        QVector<DayLoad> loads;
+        for (const QDate &date : stale) {
+            DayLoad load;
+            load.date = date;
+            load.sig = store.signature(date);
+            load.ok = store.loadFields(date, load.events, EventScanner::TimeAndTag, &load.error);
+            loads.append(load);
+        }
+        return loads;
+    }));
+}
+
+void MainWindow::highlightCalendar()
+{
+    if (!m_manifestReady)
         return;
+
+    QCalendarWidget *calendar = ui->calendarWidget;
+    calendar->setDateTextFormat(QDate(), QTextCharFormat());   // сброс прежних отметок
+
+    // Сетка месяца захватывает хвосты соседних — берём с запасом
+    const QDate month(calendar->yearShown(), calendar->monthShown(), 1);
+    const QVector<QDate> days = m_manifest->days(month.addDays(-7), month.addMonths(1).addDays(14));
+    for (const QDate &date : days) {
+        const DayManifest::DayInfo info = m_manifest->info(date);
+        if (info.eventCount == 0)
+            continue;
+
+        // Чем больше занятых минут, тем насыщеннее фон (насыщение — от 8 часов)
+        QColor background = palette().color(QPalette::Highlight);
+        background.setAlpha(40 + qMin(info.minutes, 8 * 60) * 140 / (8 * 60));
+        QTextCharFormat format;
+        format.setFontWeight(QFont::Bold);
+        format.setBackground(background);
+        calendar->setDateTextFormat(date, format);
     }
+}
 
-    const QJsonDocument doc(arr);
-    const QByteArray bytes = doc.toJson(QJsonDocument::Indented);
+void MainWindow::indexDays(const QList<QDate> &dates)
+{
+    SearchIndex *index = m_search;
+    (void)QtConcurrent::run([index, dates]() {     // результат не нужен
+        for (const QDate &date : dates)
+            index->refreshDay(date);
+    });
+}
 
-    if (file.write(bytes) != bytes.size()) {
-        QMessageBox::warning(this, "Ошибка записи",
-                             "Не удалось записать все данные в файл: " + filename);
+void MainWindow::startSearch()
+{
+    m_searchTimer->stop();
+    ui->listWidgetSearch->clear();
+
+    const QString query = ui->lineEditSearch->text().trimmed();
+    const bool searching = !query.isEmpty();
+    ui->listWidgetSearch->setVisible(searching);
+    ui->listViewEvents->setVisible(!searching);
+    if (!searching) {
+        m_searchWatcher->cancel();
+        statusBar()->clearMessage();
         return;
     }
 
-    if (!file.commit()) {
-        QMessageBox::warning(this, "Ошибка сохранения",
-                             "Не удалось завершить запись файла: " + filename + "\n" + file.errorString());
-        return;
+    // Каждый год — отдельная задача; годы приходят по мере готовности
+    m_searchYears = m_search->years();
+    m_searchRowsPerYear.fill(-1, m_searchYears.size());
+    m_searchClock.start();
+    statusBar()->showMessage("Поиск…");
+
+    SearchIndex *index = m_search;
+    const std::function<QVector<SearchIndex::Hit>(int)> searchYear = [index, query](int year) {
+        return index->search(year, query, kMaxSearchHitsPerYear);
+    };
+    m_searchWatcher->setFuture(QtConcurrent::mapped(m_searchYears, searchYear));
+}
+
+void MainWindow::onSearchResultReady(int index)
+{
+    const QVector<SearchIndex::Hit> hits = m_searchWatcher->resultAt(index);
+
+    // Годы готовы не по порядку: строки года встают после всех более новых
+    int row = 0;
+    for (int i = 0; i < index; ++i)
+        row += qMax(0, m_searchRowsPerYear.at(i));
+    m_searchRowsPerYear[index] = hits.size();
+
+    for (const SearchIndex::Hit &hit : hits) {
+        auto *item = new QListWidgetItem(hit.date.toString("dd.MM.yyyy") + "  "
+                                         + hit.event.toDisplayString());
+        item->setData(Qt::UserRole, hit.date);
+        item->setData(Qt::UserRole + 1, QVariant::fromValue(hit.event.id));
+        ui->listWidgetSearch->insertItem(row++, item);
     }
 }
 
-void MainWindow::onAnalyzeClicked()
+void MainWindow::onSearchFinished()
 {
-    AnalysisDialog dialog(this);
-    dialog.setEasterEnabled(m_easterEnabled);      // ✅ пасхальный режим — в анализ
-    dialog.exec();
+    if (m_searchWatcher->isCanceled())
+        return;
+    bool truncated = false;
+    for (int rows : std::as_const(m_searchRowsPerYear))
+        truncated = truncated || rows >= kMaxSearchHitsPerYear;
+    QString message = QString("Найдено: %1 (%2 мс)")
+                          .arg(ui->listWidgetSearch->count())
+                          .arg(m_searchClock.elapsed());
+    if (truncated)
+        message += QString(" — показаны первые %1 за год").arg(kMaxSearchHitsPerYear);
+    statusBar()->showMessage(message);
 }
 
-// --- Приватный метод класса: поиск события по id ---
-int MainWindow::findEventIndexById(const QUuid& id) const
+void MainWindow::onSearchItemActivated(QListWidgetItem *item)
 {
-    const auto it = eventsByDate.find(currentDate);
-    if (it == eventsByDate.end()) return -1;
-    const QVector<Event>& events = it.value();
-    for (int i = 0; i < events.size(); ++i) {
-        if (events[i].id == id) return i;
-    }
-    return -1;
+    const QDate date = item->data(Qt::UserRole).toDate();
+    m_selectAfterLoad = item->data(Qt::UserRole + 1).value<QUuid>();
+
+    // Закрываем поиск и открываем день; событие выделится, когда день загрузится
+    ui->lineEditSearch->clear();
+    startSearch();
+    if (date == currentDate)
+        selectPendingEvent();
+    else
+        ui->calendarWidget->setSelectedDate(date);
+}
+
+void MainWindow::onImportClicked()
+{
+    const QString path = QFileDialog::getOpenFileName(
+        this, "Импорт событий", QString(),
+        "CSV и iCalendar (*.csv *.ics *.ical);;Все файлы (*)");
+    if (path.isEmpty())
+        return;
+
+    // Правки из очереди — на диск до импорта: импорт сливается с ними
+    m_writer->flush();
+    ui->pushButtonImport->setEnabled(false);
+    statusBar()->showMessage("Импорт…");
+
+    struct ImportResult {
+        bool ok = false;
+        EventImporter::Stats stats;
+        QString error;
+    };
+
+    auto *watcher = new QFutureWatcher<ImportResult>(this);
+    connect(watcher, &QFutureWatcher<ImportResult>::finished, this, [this, watcher]() {
+        const ImportResult result = watcher->result();
+        watcher->deleteLater();
+        ui->pushButtonImport->setEnabled(true);
+        statusBar()->clearMessage();
+
+        // Изменённые дни подхватит DataDirWatcher: кэш, оглавление и поиск обновятся сами
+        QString text = QString("Прочитано: %1\nДобавлено: %2\nДубликатов: %3\n"
+                               "Пропущено: %4\nЗаписано дней: %5")
+                           .arg(result.stats.read).arg(result.stats.imported)
+                           .arg(result.stats.duplicates).arg(result.stats.skipped)
+                           .arg(result.stats.daysWritten);
+        if (!result.stats.firstProblem.isEmpty())
+            text += "\n\n" + result.stats.firstProblem;
+        if (result.ok)
+            QMessageBox::information(this, "Импорт завершён", text);
+        else
+            QMessageBox::warning(this, "Ошибка импорта", result.error + "\n\n" + text);
+    });
+
+    const DayStore store = m_store;
+    QPointer<QStatusBar> status = statusBar();
+    watcher->setFuture(QtConcurrent::run([store, path, status]() {
+        EventImporter importer(store);
+        importer.setProgressCallback([status](qint64 done, qint64 total) {
+            const int percent = total > 0 ? int(done * 100 / total) : 0;
+            QMetaObject::invokeMethod(status, [status, percent]() {
+                if (status)
+                    status->showMessage(QString("Импорт… %1%").arg(percent));
+            }, Qt::QueuedConnection);
+        });
+        ImportResult result;
+        result.ok = importer.importFile(path, EventImporter::Format::Auto,
+                                        &result.stats, &result.error);
+        return result;
+    }));
+}
+
+// --- Приватный метод класса: поиск события по id (хеш-индекс дня в DayCache) ---
+int MainWindow::findEventIndexById(const QUuid& id)
+{
+    return m_days.indexOf(currentDate, id);
 }
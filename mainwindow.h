@@ -2,16 +2,29 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <QMap>
+#include <QHash>
+#include <QSet>
 #include <QDate>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
 #include <QVector>
 #include <QUuid>
 #include "event.h"
+#include "daystore.h"
+#include "daycache.h"
+#include "daymanifest.h"
+#include "searchindex.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
 
+class EventListModel;
+class DayWriter;
+class DataDirWatcher;
+class QListWidgetItem;
+class QTimer;
+
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
@@ -31,26 +44,119 @@ private slots:
 
     // Аналитика
     void onAnalyzeClicked();
+    void onTimelineClicked();
+
+    // Импорт CSV / iCalendar
+    void onImportClicked();
+
+    // Поиск по всем дням
+    void startSearch();
+    void onSearchResultReady(int index);
+    void onSearchFinished();
+    void onSearchItemActivated(QListWidgetItem *item);
 
 private:
     Ui::MainWindow *ui;
 
-    // Данные по дням
-    QMap<QDate, QVector<Event>> eventsByDate;
+    // Загруженные дни: LRU-кэш с ограничением по памяти
+    DayCache m_days;
     QDate currentDate;
 
+    // Файлы дней (./data рядом с исполняемым файлом)
+    DayStore m_store;
+
+    // Запись дней в фоновом потоке; день чист, когда подтверждены все его записи
+    DayWriter *m_writer = nullptr;
+    QHash<QDate, int> m_unconfirmedWrites;
+    // Дни с неудавшейся записью, для которых ещё не поставлен снимок:
+    // чистыми они станут только после записи снимка дня
+    QSet<QDate> m_failedWrites;
+
+    // Чужие правки в каталоге данных: устаревшие дни выбрасываются из кэша
+    DataDirWatcher *m_watcher = nullptr;
+    // Дни, изменённые на диске, пока в кэше были незаписанные правки:
+    // перечитываются, когда записаны все правки
+    QSet<QDate> m_changedOnDisk;
+
+    // Оглавление каталога: занятые дни (подсветка в календаре), число событий
+    // и минуты по дням. Открывается в фоне; правки до готовности копятся.
+    DayManifest *m_manifest = nullptr;
+    bool m_manifestReady = false;
+    QSet<QDate> m_manifestPending;
+    QTimer *m_manifestSaveTimer = nullptr;
+
+    // Полнотекстовый индекс каталога данных; обновляется в фоне после записи
+    // и чужих правок дней
+    SearchIndex *m_search = nullptr;
+    // Запрос — после паузы в наборе; результаты идут по годам, новые сначала
+    QTimer *m_searchTimer = nullptr;
+    QFutureWatcher<QVector<SearchIndex::Hit>> *m_searchWatcher = nullptr;
+    QList<int> m_searchYears;
+    QVector<int> m_searchRowsPerYear;   // -1 — год ещё не пришёл
+    QElapsedTimer m_searchClock;
+    // Событие из результатов поиска, которое выделить, когда откроется его день
+    QUuid m_selectAfterLoad;
+
+    // Результат фоновой загрузки дня
+    struct DayLoad {
+        QDate date;
+        QVector<Event> events;
+        DayStore::Signature sig;
+        bool ok = true;
+        bool generatedIds = false;
+        QString error;
+    };
+
+    // Дни, загрузка которых уже идёт в фоне
+    QSet<QDate> m_pendingLoads;
+
     // «Пасхальный режим» (вкл/выкл через чекбокс esteggcheckBox на главном окне)
     bool m_easterEnabled = false;
 
+    // Список событий текущего дня (отсортированная модель для listViewEvents)
+    EventListModel *m_model = nullptr;
+
     // Перестроение списка событий по текущей дате
     void rebuildEventList();
+    // Текущий день перечитан: в списке меняются только отличающиеся строки
+    void refreshEventList();
+    void selectRow(int row);
 
-    // Загрузка/сохранение событий выбранного дня (JSON)
-    void loadEventsForDate(const QDate &date);
+    // Полная перезапись файла дня (JSON) — в очередь фоновой записи
     void saveEventsForDate(const QDate &date);
+    // Ответы потока записи
+    void onDayWritten(const QDate &date, const DayStore::Signature &sig, int ops);
+    void onDayWriteFailed(const QDate &date, const QString &error, int ops, bool retryAsSnapshot);
+
+    // Фоновая загрузка дня и её завершение (в GUI-потоке)
+    void requestDayLoad(const QDate &date);
+    void onDayLoaded(const DayLoad &load);
+    // Упреждающая загрузка соседних дней и недель
+    void prefetchAround(const QDate &date);
+    // День уже в памяти и файлы с тех пор не менялись (или правки ещё не записаны)
+    bool isDayFresh(const QDate &date) const;
+    // Дни изменились на диске (в том числе нашей же записью)
+    void onDaysChangedOnDisk(const QList<QDate> &dates);
+    // Кнопки правки недоступны, пока текущий день грузится
+    void setDayActionsEnabled(bool on);
+
+    // Оглавление: день записан или перечитан; дни изменились на диске
+    void onManifestReady();
+    void updateManifest(const QDate &date, const QVector<Event> &events,
+                        const DayStore::Signature &sig);
+    void refreshManifestDays(const QList<QDate> &dates);
+    // Отметки занятых дней на видимой странице календаря
+    void highlightCalendar();
+
+    // Переиндексация дней для поиска (в фоне; неизменившиеся дни пропускаются)
+    void indexDays(const QList<QDate> &dates);
+    void selectPendingEvent();
+
+    // Дозапись одной правки в журнал дня (вместо перезаписи всего файла), в фоне
+    void journalEvent(const QDate &date, DayStore::JournalOp op, const Event &e);
 
     // Поиск события по устойчивому идентификатору
-    int findEventIndexById(const QUuid& id) const;
+    int findEventIndexById(const QUuid& id);
 };
 
 #endif // MAINWINDOW_H
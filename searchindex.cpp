@@ -0,0 +1,461 @@
+#include "searchindex.h"
+#include "trace.h"
+
+#include <QAtomicInt>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QReadLocker>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QSet>
+#include <QWriteLocker>
+#include <QtConcurrent>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace {
+
+const quint32 kMagic   = 0x31535454;   // "TTS1"
+const quint32 kVersion = 1;
+
+// Шард вычищается, когда удалённых событий в нём больше половины
+const int kMinDeadToCompact = 64;
+
+quint64 trigramKey(const QChar *p)
+{
+    return (quint64(p[0].unicode()) << 32) | (quint64(p[1].unicode()) << 16) | p[2].unicode();
+}
+
+void writeEvent(QDataStream &out, const Event &e)
+{
+    out << e.id << e.title << e.start << e.end << e.tag << e.description;
+}
+
+void readEvent(QDataStream &in, Event &e)
+{
+    in >> e.id >> e.title >> e.start >> e.end >> e.tag >> e.description;
+}
+
+// Счётчики из файла — только подсказка для reserve(): битый файл не должен
+// заказывать гигабайты, он просто не дочитается и будет пересобран
+int reserveHint(quint32 count)
+{
+    return int(qMin<quint32>(count, 1 << 16));
+}
+
+// Раскладка та же, что у operator<< для QHash<quint64, QVector<int>> (Qt_5_12),
+// но при чтении номера docs проверяются, а память растёт по мере чтения
+void writePostings(QDataStream &out, const QHash<quint64, QVector<int>> &postings)
+{
+    out << quint32(postings.size());
+    for (auto it = postings.constBegin(); it != postings.constEnd(); ++it) {
+        out << it.key() << quint32(it.value().size());
+        for (int doc : it.value())
+            out << qint32(doc);
+    }
+}
+
+void readPostings(QDataStream &in, int docCount, QHash<quint64, QVector<int>> &postings)
+{
+    quint32 keyCount = 0;
+    in >> keyCount;
+    postings.reserve(reserveHint(keyCount));
+    for (quint32 k = 0; k < keyCount && in.status() == QDataStream::Ok; ++k) {
+        quint64 key = 0;
+        quint32 count = 0;
+        in >> key >> count;
+        QVector<int> &docs = postings[key];
+        docs.reserve(reserveHint(count));
+        for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+            qint32 doc = 0;
+            in >> doc;
+            if (doc < 0 || doc >= docCount) {
+                in.setStatus(QDataStream::ReadCorruptData);
+                return;
+            }
+            docs.append(doc);
+        }
+    }
+}
+
+} // namespace
+
+SearchIndex::SearchIndex(const QString &dataDir)
+    : m_store(dataDir)
+{
+}
+
+QString SearchIndex::indexPath(const QString &dataDir)
+{
+    return dataDir + "/archive/search.dat";
+}
+
+void SearchIndex::load()
+{
+    QWriteLocker locker(&m_lock);
+    m_shards.clear();
+    m_days.clear();
+    m_dirty = false;
+
+    QFile file(indexPath(m_store.dataDir()));
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_12);
+
+    quint32 magic = 0, version = 0, dayCount = 0, shardCount = 0;
+    in >> magic >> version;
+    if (magic != kMagic || version != kVersion)
+        return;
+
+    in >> dayCount;
+    m_days.reserve(reserveHint(dayCount));
+    for (quint32 i = 0; i < dayCount && in.status() == QDataStream::Ok; ++i) {
+        qint64 julianDay = 0;
+        DayEntry entry;
+        in >> julianDay
+           >> entry.sig.jsonMtime >> entry.sig.jsonSize
+           >> entry.sig.journalMtime >> entry.sig.journalSize;
+        m_days.insert(julianDay, entry);
+    }
+
+    in >> shardCount;
+    for (quint32 s = 0; s < shardCount && in.status() == QDataStream::Ok; ++s) {
+        qint32 year = 0;
+        quint32 docCount = 0;
+        in >> year >> docCount;
+        Shard &shard = m_shards[year];
+        shard.docs.reserve(reserveHint(docCount));
+        for (quint32 i = 0; i < docCount && in.status() == QDataStream::Ok; ++i) {
+            Doc doc;
+            in >> doc.julianDay;
+            readEvent(in, doc.event);
+            // Номера событий дня восстанавливаются по самим событиям
+            const auto day = m_days.find(doc.julianDay);
+            if (day != m_days.end())
+                day->docs.append(shard.docs.size());
+            shard.docs.append(doc);
+        }
+        readPostings(in, shard.docs.size(), shard.postings);
+    }
+
+    // Оборванный файл не используем вовсе — refreshAll() соберёт индекс заново
+    if (in.status() != QDataStream::Ok) {
+        m_shards.clear();
+        m_days.clear();
+    }
+}
+
+bool SearchIndex::save(QString *errorString)
+{
+    QWriteLocker locker(&m_lock);
+    if (!m_dirty)
+        return true;
+
+    // На диск — без удалённых событий
+    const QList<int> shardYears = m_shards.keys();
+    for (int year : shardYears) {
+        if (m_shards.value(year).dead > 0)
+            compactShard(year);
+    }
+
+    const QString path = indexPath(m_store.dataDir());
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorString)
+            *errorString = "Не удалось открыть индекс поиска для записи: " + path + "\n" + file.errorString();
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << kMagic << kVersion;
+
+    out << quint32(m_days.size());
+    for (auto it = m_days.constBegin(); it != m_days.constEnd(); ++it) {
+        const DayStore::Signature &sig = it.value().sig;
+        out << it.key() << sig.jsonMtime << sig.jsonSize << sig.journalMtime << sig.journalSize;
+    }
+
+    out << quint32(m_shards.size());
+    for (auto it = m_shards.constBegin(); it != m_shards.constEnd(); ++it) {
+        const Shard &shard = it.value();
+        out << qint32(it.key()) << quint32(shard.docs.size());
+        for (const Doc &doc : shard.docs) {
+            out << doc.julianDay;
+            writeEvent(out, doc.event);
+        }
+        writePostings(out, shard.postings);
+    }
+
+    if (out.status() != QDataStream::Ok || !file.commit()) {
+        if (errorString)
+            *errorString = "Не удалось записать индекс поиска: " + path + "\n" + file.errorString();
+        return false;
+    }
+    m_dirty = false;
+    return true;
+}
+
+bool SearchIndex::refreshDay(const QDate &date)
+{
+    const qint64 key = date.toJulianDay();
+    const DayStore::Signature sig = m_store.signature(date);   // до чтения — см. DayStore
+    {
+        QReadLocker locker(&m_lock);
+        const auto it = m_days.constFind(key);
+        if (it != m_days.constEnd() ? it.value().sig == sig : !sig.exists())
+            return false;
+    }
+
+    if (!sig.exists()) {
+        QWriteLocker locker(&m_lock);
+        removeDay(key);
+        return true;
+    }
+
+    // Разбор — вне блокировки. Битый файл индексируется пустым, но с подписью:
+    // заново он разберётся только после правки (как в TagRollupCache).
+    QVector<Event> events;
+    if (!m_store.loadFields(date, events, EventScanner::AllFields))
+        events.clear();
+
+    QWriteLocker locker(&m_lock);
+    replaceDay(date, sig, events);
+    return true;
+}
+
+int SearchIndex::refreshAll()
+{
+    TRACE_SCOPE("SearchIndex::refreshAll");
+    QSet<qint64> present;
+    QVector<QDate> days;
+    const QStringList names = QDir(m_store.dataDir()).entryList(
+        { QStringLiteral("*.json"), QStringLiteral("*.journal") }, QDir::Files);
+    for (const QString &name : names) {
+        const QDate date = QDate::fromString(name.section('.', 0, 0), QStringLiteral("yyyy-MM-dd"));
+        if (date.isValid() && !present.contains(date.toJulianDay())) {
+            present.insert(date.toJulianDay());
+            days.append(date);
+        }
+    }
+
+    QAtomicInt changed;
+    QtConcurrent::blockingMap(days, [this, &changed](const QDate &date) {
+        if (refreshDay(date))
+            changed.ref();
+    });
+
+    // Дни, файлы которых удалили
+    QWriteLocker locker(&m_lock);
+    const QList<qint64> known = m_days.keys();
+    for (qint64 key : known) {
+        if (!present.contains(key)) {
+            removeDay(key);
+            changed.ref();
+        }
+    }
+    return changed.loadAcquire();
+}
+
+QList<int> SearchIndex::years() const
+{
+    QReadLocker locker(&m_lock);
+    QList<int> result;
+    for (auto it = m_shards.constBegin(); it != m_shards.constEnd(); ++it) {
+        if (it->docs.size() > it->dead)
+            result.prepend(it.key());
+    }
+    return result;
+}
+
+QStringList SearchIndex::queryWords(const QString &query)
+{
+    return query.toCaseFolded().split(QRegularExpression(QStringLiteral("\\s+")),
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+                                      Qt::SkipEmptyParts);
+#else
+                                      QString::SkipEmptyParts);
+#endif
+}
+
+QVector<SearchIndex::Hit> SearchIndex::search(int year, const QString &query, int limit) const
+{
+    TRACE_SCOPE("SearchIndex::search");
+    QVector<Hit> hits;
+    const QStringList words = queryWords(query);
+    if (words.isEmpty())
+        return hits;
+
+    QReadLocker locker(&m_lock);
+    const auto shardIt = m_shards.constFind(year);
+    if (shardIt == m_shards.constEnd())
+        return hits;
+    const Shard &shard = shardIt.value();
+
+    // Списки всех триграмм запроса; хоть одной нет — совпадений нет
+    QVector<const QVector<int> *> lists;
+    for (const QString &word : words) {
+        for (quint64 t : trigrams(word)) {
+            const auto it = shard.postings.constFind(t);
+            if (it == shard.postings.constEnd())
+                return hits;
+            lists.append(&it.value());
+        }
+    }
+
+    // Пересечение — от самого короткого списка
+    QVector<int> candidates;
+    if (lists.isEmpty()) {
+        // Только слова короче трёх букв — проверяем все события года
+        candidates.reserve(shard.docs.size());
+        for (int i = 0; i < shard.docs.size(); ++i)
+            candidates.append(i);
+    } else {
+        std::sort(lists.begin(), lists.end(),
+                  [](const QVector<int> *a, const QVector<int> *b) { return a->size() < b->size(); });
+        candidates = *lists.first();
+        QVector<int> next;
+        for (int i = 1; i < lists.size() && !candidates.isEmpty(); ++i) {
+            next.clear();
+            std::set_intersection(candidates.cbegin(), candidates.cend(),
+                                  lists.at(i)->cbegin(), lists.at(i)->cend(),
+                                  std::back_inserter(next));
+            candidates.swap(next);
+        }
+    }
+
+    // Триграммы дают кандидатов; подстрока проверяется по самому тексту
+    for (int index : std::as_const(candidates)) {
+        const Doc &doc = shard.docs.at(index);
+        if (!doc.alive)
+            continue;
+        const QString text = foldedText(doc.event);
+        bool all = true;
+        for (const QString &word : words) {
+            if (!text.contains(word)) {
+                all = false;
+                break;
+            }
+        }
+        if (all)
+            hits.append({ QDate::fromJulianDay(doc.julianDay), doc.event });
+    }
+    locker.unlock();
+
+    std::sort(hits.begin(), hits.end(), [](const Hit &a, const Hit &b) {
+        if (a.date != b.date)
+            return a.date > b.date;
+        return a.event.start < b.event.start;
+    });
+    if (limit > 0 && hits.size() > limit)
+        hits.resize(limit);
+    return hits;
+}
+
+void SearchIndex::replaceDay(const QDate &date, const DayStore::Signature &sig,
+                             const QVector<Event> &events)
+{
+    const qint64 key = date.toJulianDay();
+    removeDay(key);
+
+    DayEntry &entry = m_days[key];
+    entry.sig = sig;
+    Shard &shard = m_shards[date.year()];
+    for (const Event &e : events) {
+        // Новые номера больше всех прежних — списки остаются упорядоченными
+        const int index = shard.docs.size();
+        Doc doc;
+        doc.julianDay = key;
+        doc.event = e;
+        shard.docs.append(doc);
+        indexDoc(shard, index);
+        entry.docs.append(index);
+    }
+    m_dirty = true;
+
+    if (shard.dead >= kMinDeadToCompact && shard.dead * 2 > shard.docs.size())
+        compactShard(date.year());
+}
+
+void SearchIndex::removeDay(qint64 julianDay)
+{
+    const auto it = m_days.find(julianDay);
+    if (it == m_days.end())
+        return;
+
+    // События лишь помечаются удалёнными: списки триграмм не трогаем
+    const int year = QDate::fromJulianDay(julianDay).year();
+    const auto shardIt = m_shards.find(year);
+    if (shardIt != m_shards.end()) {
+        for (int index : std::as_const(it->docs)) {
+            Doc &doc = shardIt->docs[index];
+            if (doc.alive) {
+                doc.alive = false;
+                doc.event = Event();
+                ++shardIt->dead;
+            }
+        }
+    }
+    m_days.erase(it);
+    m_dirty = true;
+}
+
+void SearchIndex::compactShard(int year)
+{
+    Shard &shard = m_shards[year];
+    QVector<Doc> alive;
+    alive.reserve(shard.docs.size() - shard.dead);
+    for (const Doc &doc : std::as_const(shard.docs)) {
+        if (doc.alive)
+            alive.append(doc);
+    }
+    if (alive.isEmpty()) {
+        m_shards.remove(year);
+        return;
+    }
+
+    shard.docs.swap(alive);
+    shard.dead = 0;
+    shard.postings.clear();
+    for (auto it = m_days.begin(); it != m_days.end(); ++it) {
+        if (QDate::fromJulianDay(it.key()).year() == year)
+            it->docs.clear();
+    }
+    for (int i = 0; i < shard.docs.size(); ++i) {
+        indexDoc(shard, i);
+        m_days[shard.docs.at(i).julianDay].docs.append(i);
+    }
+}
+
+void SearchIndex::indexDoc(Shard &shard, int docIndex)
+{
+    for (quint64 t : trigrams(foldedText(shard.docs.at(docIndex).event)))
+        shard.postings[t].append(docIndex);
+}
+
+QString SearchIndex::foldedText(const Event &e)
+{
+    // Перевод строки в запрос не попадает — триграммы на стыке полей не совпадут
+    return (e.title + QLatin1Char('\n') + e.tag + QLatin1Char('\n') + e.description).toCaseFolded();
+}
+
+QVector<quint64> SearchIndex::trigrams(const QString &text)
+{
+    QVector<quint64> result;
+    if (text.size() < 3)
+        return result;
+    result.reserve(text.size() - 2);
+    const QChar *p = text.constData();
+    for (int i = 0; i + 3 <= text.size(); ++i)
+        result.append(trigramKey(p + i));
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
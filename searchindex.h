@@ -0,0 +1,93 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QDate>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QReadWriteLock>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "daystore.h"
+#include "event.h"
+
+// Полнотекстовый поиск по названию, тегу и описанию событий всех дней
+// каталога данных. Индекс триграммный (триграмма → номера событий) и
+// разбит по годам: поиск по годам идёт параллельно, а правка дня трогает
+// только свой год. Хранится в dataDir/archive/search.dat; день
+// переиндексируется, когда изменилась подпись его файлов
+// (DayStore::Signature), как и в TagRollupCache.
+// Потокобезопасен: поиск — под блокировкой чтения, разбор дня — без блокировки.
+class SearchIndex
+{
+public:
+    struct Hit {
+        QDate date;
+        Event event;
+    };
+
+    explicit SearchIndex(const QString &dataDir);
+
+    static QString indexPath(const QString &dataDir);
+
+    // Чтение индекса с диска; отсутствующий или несовместимый файл — пустой индекс
+    void load();
+    // Запись на диск, только если были изменения
+    bool save(QString *errorString = nullptr);
+
+    // Переиндексация дня, если его файлы изменились; true — индекс изменился
+    bool refreshDay(const QDate &date);
+    // Все дни каталога (по именам файлов, параллельно); пропавшие дни
+    // удаляются. Возвращает число переиндексированных дней.
+    int refreshAll();
+
+    // Годы, в которых есть события, — от новых к старым
+    QList<int> years() const;
+
+    // События года, где встречаются все слова запроса (без учёта регистра,
+    // как подстроки). Новые дни сначала, внутри дня — по времени начала.
+    // limit > 0 — не больше limit совпадений.
+    QVector<Hit> search(int year, const QString &query, int limit = 0) const;
+
+    // Слова запроса в виде для сравнения (casefold, без пустых)
+    static QStringList queryWords(const QString &query);
+
+private:
+    struct Doc {
+        qint64 julianDay = 0;
+        Event event;
+        bool alive = true;
+    };
+
+    struct Shard {
+        QVector<Doc> docs;
+        QHash<quint64, QVector<int>> postings;  // триграмма → номера docs по возрастанию
+        int dead = 0;                           // удалённые, но ещё не вычищенные
+    };
+
+    struct DayEntry {
+        DayStore::Signature sig;
+        QVector<int> docs;                      // номера в шарде года
+    };
+
+    DayStore m_store;
+    QMap<int, Shard> m_shards;                  // ключ — год
+    QHash<qint64, DayEntry> m_days;             // ключ — юлианский день
+    bool m_dirty = false;
+    mutable QReadWriteLock m_lock;
+
+    // Всё ниже — под блокировкой записи
+    void replaceDay(const QDate &date, const DayStore::Signature &sig,
+                    const QVector<Event> &events);
+    void removeDay(qint64 julianDay);
+    void compactShard(int year);
+    static void indexDoc(Shard &shard, int docIndex);
+
+    // Текст события для поиска: название, тег и описание через перевод строки
+    static QString foldedText(const Event &e);
+    // Триграммы текста без повторов, по возрастанию
+    static QVector<quint64> trigrams(const QString &text);
+};
+
+#endif // SEARCHINDEX_H
@@ -0,0 +1,518 @@
+#include "taganalyzer.h"
+#include "daybitmap.h"
+#include "daymanifest.h"
+#include "daystore.h"
+#include "eventarchive.h"
+#include "tagrollupcache.h"
+#include "trace.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QStandardPaths>
+#include <QtConcurrent>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace {
+
+bool hasDayData(const DayStore &store, const QDate &date)
+{
+    return QFileInfo::exists(store.filePathForDate(date))
+           || QFileInfo::exists(store.journalPathForDate(date));
+}
+
+// Кэши сумм по каталогам. Файлы кэшей читаются при первом запросе дня (для
+// параллельного пути — уже в пуле), сохраняются при разрушении — то есть когда
+// отпущена последняя ссылка (для параллельного пути — по завершении задачи)
+struct RollupCaches
+{
+    RollupCaches(const QStringList &dataDirs, bool useArchive)
+    {
+        for (const QString &dir : dataDirs) {
+            byDir.emplace_back(new TagRollupCache(dir));
+            byDir.back()->setUseArchive(useArchive);
+        }
+    }
+
+    ~RollupCaches()
+    {
+        // Кэш — не источник истины: если записать не удалось, в следующий раз пересчитаем
+        for (const auto &cache : byDir)
+            cache->save();
+    }
+
+    std::vector<std::unique_ptr<TagRollupCache>> byDir;
+};
+
+// Суммы за один день: первый каталог, где есть данные дня; кэш или разбор JSON
+QMap<QString, int> dayTotals(const QStringList &dataDirs, RollupCaches *caches, const QDate &date)
+{
+    TRACE_SCOPE("dayTotals");
+    for (int i = 0; i < dataDirs.size(); ++i) {
+        const DayStore store(dataDirs[i]);
+        const DayStore::Signature sig = store.signature(date);
+        if (!sig.exists())
+            continue;
+
+        if (caches)
+            return caches->byDir[i]->dayTotals(date, sig);
+
+        // Битые файлы пропускаем молча, как и раньше
+        QMap<QString, int> totals;
+        QVector<Event> events;
+        if (store.loadFields(date, events, EventScanner::TimeAndTag))
+            TagAnalyzer::accumulate(events, totals);
+        return totals;
+    }
+    return QMap<QString, int>();
+}
+
+// Статистика сессий за один день — как dayTotals()
+TagStatisticsMap dayStatistics(const QStringList &dataDirs, RollupCaches *caches, const QDate &date)
+{
+    TRACE_SCOPE("dayStatistics");
+    for (int i = 0; i < dataDirs.size(); ++i) {
+        const DayStore store(dataDirs[i]);
+        const DayStore::Signature sig = store.signature(date);
+        if (!sig.exists())
+            continue;
+
+        if (caches)
+            return caches->byDir[i]->dayStatistics(date, sig);
+
+        TagStatisticsMap stats;
+        QVector<Event> events;
+        if (store.loadFields(date, events, EventScanner::TimeAndTag))
+            TagAnalyzer::accumulateStatistics(date, events, stats);
+        return stats;
+    }
+    return TagStatisticsMap();
+}
+
+// Месяц диапазона — единица работы и прогресса параллельного анализа: список
+// занятых дней (оглавление) и кэши строятся уже в пуле, а не в вызывающем потоке
+struct MonthSpan
+{
+    QDate first;
+    QDate last;
+};
+
+QVector<MonthSpan> monthsOf(const QDate &from, const QDate &to)
+{
+    QVector<MonthSpan> months;
+    if (!from.isValid() || !to.isValid() || from > to)
+        return months;
+    for (QDate month(from.year(), from.month(), 1); month <= to; month = month.addMonths(1))
+        months.append({ qMax(from, month), qMin(to, month.addMonths(1).addDays(-1)) });
+    return months;
+}
+
+// События дня для подсчёта: первый каталог с данными, только тег и время
+void loadDayForAnalysis(const QStringList &dataDirs, const QDate &date, QVector<Event> &events)
+{
+    events.clear();
+    for (const QString &dir : dataDirs) {
+        const DayStore store(dir);
+        if (!hasDayData(store, date))
+            continue;
+        // Битые файлы пропускаем молча, как и раньше
+        if (!store.loadFields(date, events, EventScanner::TimeAndTag))
+            events.clear();
+        return;
+    }
+}
+
+// Минуты битовой карты дня по часам — в строку тепловой карты
+void addToHeatmap(const DayBitmap &bitmap, int dayOfWeek, QVector<int> &heatmap)
+{
+    if (heatmap.isEmpty())
+        heatmap.fill(0, 7 * 24);
+    int *row = heatmap.data() + (dayOfWeek - 1) * 24;
+    for (int hour = 0; hour < 24; ++hour)
+        row[hour] += bitmap.countRange(hour * 60, hour * 60 + 60);
+}
+
+void mergeTotals(QMap<QString, int> &result, const QMap<QString, int> &day)
+{
+    for (auto it = day.constBegin(); it != day.constEnd(); ++it)
+        result[it.key()] += it.value();
+}
+
+} // namespace
+
+TagAnalyzer::TagAnalyzer(const QStringList &dataDirs)
+    : m_dataDirs(dataDirs)
+{
+}
+
+QStringList TagAnalyzer::defaultDataDirs()
+{
+    return { QStandardPaths::writableLocation(QStandardPaths::AppDataLocation),
+             QDir::current().filePath(QStringLiteral("data")) };
+}
+
+QString TagAnalyzer::dataDirForDate(const QDate &date) const
+{
+    for (const QString &dir : m_dataDirs) {
+        if (hasDayData(DayStore(dir), date))
+            return dir;
+    }
+    return QString();
+}
+
+int TagAnalyzer::durationMinutes(const QTime &start, const QTime &end)
+{
+    int duration = start.secsTo(end) / 60;
+    if (duration < 0)
+        duration += 24 * 60; // переход через полночь
+    return duration;
+}
+
+QString TagAnalyzer::tagLabel(const QString &rawTag)
+{
+    const QString tag = rawTag.trimmed();
+    return tag.isEmpty() ? untaggedLabel() : tag;
+}
+
+void TagAnalyzer::accumulate(const QVector<Event> &events, QMap<QString, int> &tagDurations)
+{
+    for (const Event &e : events) {
+        if (!e.start.isValid() || !e.end.isValid())
+            continue;
+        tagDurations[tagLabel(e.tag)] += durationMinutes(e.start, e.end);
+    }
+}
+
+void TagAnalyzer::accumulateStatistics(const QDate &date, const QVector<Event> &events,
+                                       TagStatisticsMap &stats)
+{
+    for (const Event &e : events) {
+        if (!e.start.isValid() || !e.end.isValid())
+            continue;
+        Session session;
+        session.minutes = durationMinutes(e.start, e.end);
+        session.date = date;
+        session.start = e.start;
+        stats[tagLabel(e.tag)].add(session);
+    }
+}
+
+void TagAnalyzer::accumulateRows(const EventArchive &archive, int firstRow, int count,
+                                 QVector<int> &minutesByTag, QVector<bool> &seenTags)
+{
+    const qint16  *starts = archive.startColumn() + firstRow;
+    const qint16  *ends   = archive.endColumn() + firstRow;
+    const quint32 *tags   = archive.tagColumn() + firstRow;
+
+    for (int i = 0; i < count; ++i) {
+        if (starts[i] < 0 || ends[i] < 0)
+            continue;
+
+        int duration = ends[i] - starts[i];
+        if (duration < 0)
+            duration += 24 * 60; // переход через полночь
+
+        minutesByTag[int(tags[i])] += duration;
+        seenTags[int(tags[i])] = true;
+    }
+}
+
+QMap<QString, int> TagAnalyzer::aggregate(const QDate &from, const QDate &to) const
+{
+    TRACE_SCOPE("TagAnalyzer::aggregate");
+    QMap<QString, int> tagDurations;
+    if (!from.isValid() || !to.isValid() || from > to)
+        return tagDurations;
+
+    if (m_useRollups) {
+        aggregateRollups(from, to, tagDurations);
+        return tagDurations;
+    }
+
+    for (QDate month(from.year(), from.month(), 1); month <= to; month = month.addMonths(1)) {
+        const QDate first = qMax(from, month);
+        const QDate last  = qMin(to, month.addMonths(1).addDays(-1));
+        aggregateMonth(first, last, tagDurations);
+    }
+
+    return tagDurations;
+}
+
+QFuture<QMap<QString, int>> TagAnalyzer::aggregateConcurrent(const QDate &from, const QDate &to) const
+{
+    const TagAnalyzer analyzer = *this;
+    std::shared_ptr<RollupCaches> caches;
+    if (m_useRollups)
+        caches = std::make_shared<RollupCaches>(m_dataDirs, m_useArchive);
+
+    // std::function — чтобы у функтора был result_type и для Qt 5.
+    // Пустые даты не обрабатываются вовсе: дни месяца — по оглавлению
+    const std::function<QMap<QString, int>(const MonthSpan &)> mapMonth =
+        [analyzer, caches](const MonthSpan &month) {
+            QMap<QString, int> totals;
+            for (const QDate &date : analyzer.populatedDays(month.first, month.last))
+                mergeTotals(totals, dayTotals(analyzer.m_dataDirs, caches.get(), date));
+            return totals;
+        };
+
+    return QtConcurrent::mappedReduced<QMap<QString, int>>(
+        monthsOf(from, to), mapMonth, mergeTotals, QtConcurrent::UnorderedReduce);
+}
+
+QFuture<TagStatisticsMap> TagAnalyzer::statisticsConcurrent(const QDate &from, const QDate &to) const
+{
+    const TagAnalyzer analyzer = *this;
+    std::shared_ptr<RollupCaches> caches;
+    if (m_useRollups)
+        caches = std::make_shared<RollupCaches>(m_dataDirs, m_useArchive);
+
+    const std::function<TagStatisticsMap(const MonthSpan &)> mapMonth =
+        [analyzer, caches](const MonthSpan &month) {
+            TagStatisticsMap stats;
+            for (const QDate &date : analyzer.populatedDays(month.first, month.last))
+                mergeStatistics(stats, dayStatistics(analyzer.m_dataDirs, caches.get(), date));
+            return stats;
+        };
+
+    return QtConcurrent::mappedReduced<TagStatisticsMap>(
+        monthsOf(from, to), mapMonth, mergeStatistics, QtConcurrent::UnorderedReduce);
+}
+
+QMap<QString, QVector<Session>> TagAnalyzer::longestSessions(const TagStatisticsMap &stats) const
+{
+    TRACE_SCOPE("TagAnalyzer::longestSessions");
+    QMap<QString, QVector<Session>> result;
+    QMap<QDate, QVector<QPair<QString, Session *>>> byDate;     // тег и сессия по дням
+    for (auto it = stats.constBegin(); it != stats.constEnd(); ++it)
+        result.insert(it.key(), it.value().longest.sorted());
+    for (auto it = result.begin(); it != result.end(); ++it) {
+        for (Session &s : it.value())
+            byDate[s.date].append(qMakePair(it.key(), &s));
+    }
+
+    QVector<Event> events;
+    for (auto it = byDate.constBegin(); it != byDate.constEnd(); ++it) {
+        const QString dir = dataDirForDate(it.key());
+        if (dir.isEmpty())
+            continue;
+        const EventScanner::Fields fields = EventScanner::TimeAndTag | EventScanner::Title;
+        if (!DayStore(dir).loadFields(it.key(), events, fields))
+            continue;
+        // Сессия узнаётся по тегу, началу и длительности
+        for (const auto &tagged : it.value()) {
+            Session *s = tagged.second;
+            for (const Event &e : std::as_const(events)) {
+                if (e.start == s->start && e.end.isValid()
+                    && durationMinutes(e.start, e.end) == s->minutes
+                    && tagLabel(e.tag) == tagged.first) {
+                    s->title = e.title;
+                    break;
+                }
+            }
+        }
+    }
+    return result;
+}
+
+bool TagAnalyzer::dataRange(QDate *first, QDate *last) const
+{
+    QDate lo, hi;
+    for (const QString &dir : m_dataDirs) {
+        const std::shared_ptr<const DayManifest> manifest = DayManifest::shared(dir);
+        const QDate dirFirst = manifest->firstDay();
+        if (!dirFirst.isValid())
+            continue;
+        const QDate dirLast = manifest->lastDay();
+        if (!lo.isValid() || dirFirst < lo) lo = dirFirst;
+        if (!hi.isValid() || dirLast > hi) hi = dirLast;
+    }
+    if (first) *first = lo;
+    if (last) *last = hi;
+    return lo.isValid();
+}
+
+QVector<QDate> TagAnalyzer::populatedDays(const QDate &from, const QDate &to) const
+{
+    if (!from.isValid() || !to.isValid() || from > to)
+        return QVector<QDate>();
+
+    QVector<QDate> days;
+    for (const QString &dir : m_dataDirs) {
+        days += DayManifest::shared(dir)->days(from, to);
+    }
+    // Несколько каталогов — объединение без повторов
+    if (m_dataDirs.size() > 1) {
+        std::sort(days.begin(), days.end());
+        days.erase(std::unique(days.begin(), days.end()), days.end());
+    }
+    return days;
+}
+
+TagAnalyzer::DailySeries TagAnalyzer::dailySeries(const QDate &from, const QDate &to) const
+{
+    TRACE_SCOPE("TagAnalyzer::dailySeries");
+    DailySeries series;
+    series.first = from;
+    if (!from.isValid() || !to.isValid() || from > to)
+        return series;
+
+    const QVector<QDate> days = populatedDays(from, to);
+
+    const QStringList dataDirs = m_dataDirs;
+    std::unique_ptr<RollupCaches> caches;
+    if (m_useRollups)
+        caches.reset(new RollupCaches(dataDirs, m_useArchive));
+    RollupCaches *cachesPtr = caches.get();
+
+    const std::function<QMap<QString, int>(const QDate &)> mapDay =
+        [dataDirs, cachesPtr](const QDate &date) {
+            return dayTotals(dataDirs, cachesPtr, date);
+        };
+    const QList<QMap<QString, int>> perDay =
+        QtConcurrent::blockingMapped<QList<QMap<QString, int>>>(days, mapDay);
+
+    // Теги по убыванию общего времени — крупные ряды первыми
+    QMap<QString, qint64> totals;
+    for (const QMap<QString, int> &day : perDay) {
+        for (auto it = day.constBegin(); it != day.constEnd(); ++it)
+            totals[it.key()] += it.value();
+    }
+    series.tags = totals.keys();
+    std::stable_sort(series.tags.begin(), series.tags.end(), [&totals](const QString &a, const QString &b) {
+        return totals.value(a) > totals.value(b);
+    });
+
+    QHash<QString, int> tagIndex;
+    for (int i = 0; i < series.tags.size(); ++i)
+        tagIndex.insert(series.tags.at(i), i);
+
+    // Ряды — по всем дням диапазона, пустые остаются нулями
+    series.minutes.fill(QVector<int>(int(from.daysTo(to) + 1), 0), series.tags.size());
+    for (int i = 0; i < perDay.size(); ++i) {
+        const int day = int(from.daysTo(days.at(i)));
+        const QMap<QString, int> &totalsOfDay = perDay.at(i);
+        for (auto it = totalsOfDay.constBegin(); it != totalsOfDay.constEnd(); ++it)
+            series.minutes[tagIndex.value(it.key())][day] = it.value();
+    }
+    return series;
+}
+
+TagAnalyzer::Occupancy TagAnalyzer::occupancy(const QDate &from, const QDate &to) const
+{
+    TRACE_SCOPE("TagAnalyzer::occupancy");
+    Occupancy result;
+    result.heatmap.fill(0, 7 * 24);
+    if (!from.isValid() || !to.isValid() || from > to)
+        return result;
+
+    // Хвосты событий после полуночи предыдущего дня
+    QHash<QString, DayBitmap> carryByTag;
+    DayBitmap carrySeen, carryTwice;
+
+    QVector<Event> events;
+    for (QDate date = from.addDays(-1); date <= to; date = date.addDays(1)) {
+        QHash<QString, DayBitmap> byTag;
+        byTag.swap(carryByTag);
+        DayBitmap seen = carrySeen, twice = carryTwice;    // «занято» и «занято дважды»
+        DayBitmap nextSeen, nextTwice;
+
+        loadDayForAnalysis(m_dataDirs, date, events);
+        for (const Event &e : events) {
+            if (!e.start.isValid() || !e.end.isValid())
+                continue;
+
+            DayBitmap today, tomorrow;
+            DayBitmap::addInterval(e.start.hour() * 60 + e.start.minute(),
+                                   e.end.hour() * 60 + e.end.minute(), today, tomorrow);
+            const QString tag = tagLabel(e.tag);
+
+            byTag[tag] |= today;
+            twice |= seen & today;
+            seen |= today;
+            if (!tomorrow.isEmpty()) {
+                carryByTag[tag] |= tomorrow;
+                nextTwice |= nextSeen & tomorrow;
+                nextSeen |= tomorrow;
+            }
+        }
+        carrySeen = nextSeen;
+        carryTwice = nextTwice;
+
+        if (date < from)
+            continue;   // день перед диапазоном нужен только ради хвостов
+
+        const int dayOfWeek = date.dayOfWeek();
+        for (auto it = byTag.constBegin(); it != byTag.constEnd(); ++it) {
+            result.minutesByTag[it.key()] += it.value().count();
+            addToHeatmap(it.value(), dayOfWeek, result.heatmapByTag[it.key()]);
+        }
+        result.busyMinutes += seen.count();
+        result.overlapMinutes += twice.count();
+        addToHeatmap(seen, dayOfWeek, result.heatmap);
+    }
+    return result;
+}
+
+void TagAnalyzer::aggregateRollups(const QDate &from, const QDate &to,
+                                   QMap<QString, int> &tagDurations) const
+{
+    RollupCaches caches(m_dataDirs, m_useArchive);
+    for (const QDate &date : populatedDays(from, to))
+        mergeTotals(tagDurations, dayTotals(m_dataDirs, &caches, date));
+}
+
+void TagAnalyzer::aggregateMonth(const QDate &first, const QDate &last,
+                                 QMap<QString, int> &tagDurations) const
+{
+    TRACE_SCOPE("TagAnalyzer::aggregateMonth");
+    // Архив месяца по каждому каталогу; пустой указатель — архив недоступен
+    // (например, каталог только для чтения), тогда дни этого каталога читаем из JSON
+    const int dirCount = m_dataDirs.size();
+    std::vector<std::unique_ptr<EventArchive>> archives(dirCount);
+    std::vector<QVector<int>> minutesByTag(dirCount);
+    std::vector<QVector<bool>> seenTags(dirCount);
+    if (m_useArchive) {
+        for (int i = 0; i < dirCount; ++i) {
+            std::unique_ptr<EventArchive> archive(new EventArchive);
+            if (!archive->openFresh(m_dataDirs[i], first))
+                continue;
+            minutesByTag[i].fill(0, archive->tagCount());
+            seenTags[i].fill(false, archive->tagCount());
+            archives[i] = std::move(archive);
+        }
+    }
+
+    QVector<Event> events;
+    for (QDate date = first; date <= last; date = date.addDays(1)) {
+        for (int i = 0; i < dirCount; ++i) {
+            if (archives[i]) {
+                if (!archives[i]->hasDay(date))
+                    continue;
+                accumulateRows(*archives[i], archives[i]->firstRowOfDay(date),
+                               archives[i]->rowCountOfDay(date), minutesByTag[i], seenTags[i]);
+                break;
+            }
+
+            const DayStore store(m_dataDirs[i]);
+            if (!hasDayData(store, date))
+                continue;
+
+            // Битые файлы пропускаем молча, как и раньше
+            if (store.loadFields(date, events, EventScanner::TimeAndTag))
+                accumulate(events, tagDurations);
+            break;
+        }
+    }
+
+    // Суммы по id тегов переводим в подписи один раз на месяц
+    for (int i = 0; i < dirCount; ++i) {
+        for (int tagId = 0; tagId < minutesByTag[i].size(); ++tagId) {
+            if (seenTags[i][tagId])
+                tagDurations[tagLabel(archives[i]->tag(quint32(tagId)))] += minutesByTag[i][tagId];
+        }
+    }
+}
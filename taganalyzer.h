@@ -0,0 +1,132 @@
+#ifndef TAGANALYZER_H
+#define TAGANALYZER_H
+
+#include <QDate>
+#include <QFuture>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QTime>
+#include <QVector>
+#include "event.h"
+#include "tagstatistics.h"
+
+class EventArchive;
+
+// Агрегация минут по тегам за диапазон дат. Без виджетов — используется
+// и диалогом анализа, и бенчмарком.
+class TagAnalyzer
+{
+public:
+    // Минуты по дням для графиков динамики
+    struct DailySeries {
+        QDate first;                        // день с индексом 0
+        QStringList tags;                   // по убыванию общего времени
+        QVector<QVector<int>> minutes;      // minutes[номер тега][номер дня]
+        int dayCount() const { return minutes.isEmpty() ? 0 : minutes.first().size(); }
+    };
+
+    // Занятость по минутам (DayBitmap): в отличие от сумм длительностей,
+    // пересекающиеся события не считаются дважды
+    struct Occupancy {
+        QMap<QString, int> minutesByTag;    // объединение событий тега
+        int busyMinutes = 0;                // объединение всех событий
+        int overlapMinutes = 0;             // минуты, где идут два события и больше
+        // Тепловые карты «день недели × час»: индекс (dayOfWeek - 1) * 24 + час
+        QVector<int> heatmap;
+        QMap<QString, QVector<int>> heatmapByTag;
+    };
+
+    // Каталоги просматриваются по порядку: берётся первый, где есть данные дня
+    explicit TagAnalyzer(const QStringList &dataDirs);
+
+    // Каталоги по умолчанию (диалог анализа и отчёт из командной строки):
+    // 1) системный AppDataLocation, 2) относительный ./data (совместимость)
+    static QStringList defaultDataDirs();
+
+    // Источник сумм по дням, по убыванию приоритета:
+    //   1) кэш сумм по тегам (TagRollupCache) — разбираются только изменённые дни;
+    //   2) помесячный колоночный архив (EventArchive);
+    //   3) разбор JSON каждого дня.
+    // По умолчанию включены оба кэша. С кэшем сумм архив служит его промахам:
+    // день берётся из уже записанного архива, если тот собран из текущих
+    // файлов дня (архивы пересобирает сводная таблица, EventQuery). Без кэша
+    // сумм aggregate() идёт по архивам месяцев, пересобирая устаревшие.
+    void setUseRollups(bool on) { m_useRollups = on; }
+    bool useRollups() const     { return m_useRollups; }
+    void setUseArchive(bool on) { m_useArchive = on; }
+    bool useArchive() const     { return m_useArchive; }
+
+    // Каталог с данными дня (снимок или журнал); пустая строка — данных нет
+    QString dataDirForDate(const QDate &date) const;
+
+    QMap<QString, int> aggregate(const QDate &from, const QDate &to) const;
+
+    // То же самое, но параллельно: map по месяцам диапазона в пуле QtConcurrent
+    // (занятые дни месяца и кэши читаются уже там), reduce — слияние частичных
+    // сумм. Прогресс (в месяцах) и отмена — через QFutureWatcher. Дни берутся
+    // из кэша сумм (промахи — из архива или JSON); без кэша сумм — из JSON.
+    QFuture<QMap<QString, int>> aggregateConcurrent(const QDate &from, const QDate &to) const;
+
+    // Статистика сессий по тегам: число, квантили длительности, самые
+    // длинные. Один проход по дням в пуле QtConcurrent; статистика дня —
+    // из кэша TagRollupCache (если включён), reduce — слияние эскизов.
+    // Единица работы и прогресса — месяц: занятые дни месяца (оглавление)
+    // и файлы кэшей читаются уже в пуле, вызывающий поток не ждёт.
+    // Отмена — через QFutureWatcher.
+    QFuture<TagStatisticsMap> statisticsConcurrent(const QDate &from, const QDate &to) const;
+
+    // Самые длинные сессии тегов по убыванию, с названиями (дочитываются
+    // из файлов только тех дней, куда попали эти сессии)
+    QMap<QString, QVector<Session>> longestSessions(const TagStatisticsMap &stats) const;
+
+    // Первый и последний день, для которых есть файлы (по оглавлениям
+    // каталогов, DayManifest::shared()); false — данных нет ни в одном каталоге.
+    // Как и populatedDays(), может читать файлы дней — только из фоновых потоков.
+    bool dataRange(QDate *first, QDate *last) const;
+
+    // Дни диапазона, для которых хотя бы в одном каталоге есть файлы, по
+    // возрастанию. Пустые даты анализ пропускает, не обращаясь к их файлам.
+    QVector<QDate> populatedDays(const QDate &from, const QDate &to) const;
+
+    // Суммы по тегам за каждый день диапазона (параллельно по дням; суммы
+    // дней берутся из кэша TagRollupCache, если он включён)
+    DailySeries dailySeries(const QDate &from, const QDate &to) const;
+
+    // Занятость за диапазон. Событие через полночь занимает минуты до 24:00
+    // своего дня и остаток — следующего (поэтому просматривается и день
+    // перед from; хвост последнего дня за to не попадает).
+    Occupancy occupancy(const QDate &from, const QDate &to) const;
+
+    // Длительность в минутах; end < start трактуется как переход через полночь
+    static int durationMinutes(const QTime &start, const QTime &end);
+
+    // Добавляет минуты событий дня к суммам по тегам
+    static void accumulate(const QVector<Event> &events, QMap<QString, int> &tagDurations);
+    // Добавляет сессии дня к статистике по тегам
+    static void accumulateStatistics(const QDate &date, const QVector<Event> &events,
+                                     TagStatisticsMap &stats);
+
+    // Тег для отчёта: без пробелов по краям, пустой — «Без тега»
+    static QString tagLabel(const QString &rawTag);
+    static QString untaggedLabel() { return QStringLiteral("Без тега"); }
+
+private:
+    QStringList m_dataDirs;
+    bool m_useRollups = true;
+    bool m_useArchive = true;
+
+    // Весь диапазон по кэшу сумм
+    void aggregateRollups(const QDate &from, const QDate &to,
+                          QMap<QString, int> &tagDurations) const;
+
+    // Дни одного месяца [first, last]
+    void aggregateMonth(const QDate &first, const QDate &last,
+                        QMap<QString, int> &tagDurations) const;
+
+    // Проход по колонкам архива: минуты строк [firstRow, firstRow + count) по id тега
+    static void accumulateRows(const EventArchive &archive, int firstRow, int count,
+                               QVector<int> &minutesByTag, QVector<bool> &seenTags);
+};
+
+#endif // TAGANALYZER_H
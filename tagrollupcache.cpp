@@ -0,0 +1,236 @@
+#include "tagrollupcache.h"
+#include "eventarchive.h"
+#include "taganalyzer.h"
+#include "trace.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+#include <QVector>
+
+namespace {
+
+const quint32 kMagic   = 0x31525454;   // "TTR1"
+const quint32 kVersion = 2;   // 2 — статистика сессий вместо сумм
+
+// Сколько архивов месяцев держать отображёнными. Потоки пула идут по месяцам,
+// так что в работе одновременно не больше месяцев, чем потоков
+int maxOpenArchives()
+{
+    return qMax(4, 2 * QThread::idealThreadCount());
+}
+
+} // namespace
+
+TagRollupCache::TagRollupCache(const QString &dataDir)
+    : m_store(dataDir)
+{
+}
+
+QString TagRollupCache::cachePath(const QString &dataDir)
+{
+    return dataDir + "/archive/rollups.dat";
+}
+
+void TagRollupCache::load()
+{
+    QMutexLocker locker(&m_mutex);
+    loadLocked();
+}
+
+void TagRollupCache::loadLocked()
+{
+    TRACE_SCOPE("TagRollupCache::load");
+    m_loaded = true;
+    m_days.clear();
+    m_dirty = false;
+
+    QFile file(cachePath(m_store.dataDir()));
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_12);
+
+    quint32 magic = 0, version = 0, count = 0;
+    in >> magic >> version >> count;
+    if (magic != kMagic || version != kVersion)
+        return;
+
+    m_days.reserve(int(qMin<quint32>(count, 1 << 16)));   // счётчику из файла не доверяем
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        qint64 julianDay = 0;
+        Entry entry;
+        in >> julianDay
+           >> entry.sig.jsonMtime >> entry.sig.jsonSize
+           >> entry.sig.journalMtime >> entry.sig.journalSize
+           >> entry.stats;
+        m_days.insert(julianDay, entry);
+    }
+
+    // Оборванный файл не используем вовсе — пересоберётся по ходу анализа
+    if (in.status() != QDataStream::Ok)
+        m_days.clear();
+}
+
+bool TagRollupCache::save(QString *errorString)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_dirty)
+        return true;
+
+    const QString path = cachePath(m_store.dataDir());
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorString)
+            *errorString = "Не удалось открыть кэш для записи: " + path + "\n" + file.errorString();
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << kMagic << kVersion << quint32(m_days.size());
+    for (auto it = m_days.constBegin(); it != m_days.constEnd(); ++it) {
+        const Entry &entry = it.value();
+        out << it.key()
+            << entry.sig.jsonMtime << entry.sig.jsonSize
+            << entry.sig.journalMtime << entry.sig.journalSize
+            << entry.stats;
+    }
+
+    if (out.status() != QDataStream::Ok || !file.commit()) {
+        if (errorString)
+            *errorString = "Не удалось записать кэш: " + path + "\n" + file.errorString();
+        return false;
+    }
+    m_dirty = false;
+    return true;
+}
+
+QMap<QString, int> TagRollupCache::dayTotals(const QDate &date, const DayStore::Signature &sig)
+{
+    const TagStatisticsMap stats = dayStatistics(date, sig);
+    QMap<QString, int> totals;
+    for (auto it = stats.constBegin(); it != stats.constEnd(); ++it)
+        totals.insert(it.key(), int(it.value().minutes));
+    return totals;
+}
+
+TagStatisticsMap TagRollupCache::dayStatistics(const QDate &date, const DayStore::Signature &sig)
+{
+    const qint64 key = date.toJulianDay();
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_loaded)
+            loadLocked();       // первый запрос — уже в потоке пула
+        const auto it = m_days.constFind(key);
+        if (it != m_days.constEnd() && it.value().sig == sig) {
+            ++m_hits;
+            Trace::count(Trace::CacheHits);
+            return it.value().stats;
+        }
+        ++m_misses;
+        Trace::count(Trace::CacheMisses);
+    }
+
+    // Разбор дня — вне блокировки, чтобы параллельные промахи не ждали друг друга.
+    // Битый файл даёт пустую статистику (как и раньше — день пропускается),
+    // но запоминается с подписью: повторно разбираться он будет только после правки.
+    Entry entry;
+    entry.sig = sig;
+    if (!m_useArchive || !statisticsFromArchive(date, sig, entry.stats)) {
+        QVector<Event> events;
+        if (m_store.loadFields(date, events, EventScanner::TimeAndTag))
+            TagAnalyzer::accumulateStatistics(date, events, entry.stats);
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_days.insert(key, entry);
+    m_dirty = true;
+    return entry.stats;
+}
+
+std::shared_ptr<const EventArchive> TagRollupCache::archiveFor(const QDate &date)
+{
+    const qint64 key = QDate(date.year(), date.month(), 1).toJulianDay();
+    {
+        QMutexLocker locker(&m_mutex);
+        const auto it = m_archives.find(key);
+        if (it != m_archives.end()) {
+            it.value().lastUse = ++m_archiveClock;
+            return it.value().archive;
+        }
+    }
+
+    // Отображение и проверка архива — вне блокировки
+    std::shared_ptr<EventArchive> opened = std::make_shared<EventArchive>();
+    if (!opened->openExisting(m_store.dataDir(), date))
+        opened.reset();
+
+    QMutexLocker locker(&m_mutex);
+    const auto it = m_archives.find(key);
+    if (it != m_archives.end()) {     // другой поток успел раньше
+        it.value().lastUse = ++m_archiveClock;
+        return it.value().archive;
+    }
+    if (m_archives.size() >= maxOpenArchives()) {
+        // Давно не нужный месяц закрывается; у потока, который ещё читает
+        // его, архив остаётся жив благодаря shared_ptr
+        auto oldest = m_archives.begin();
+        for (auto cur = m_archives.begin(); cur != m_archives.end(); ++cur) {
+            if (cur.value().lastUse < oldest.value().lastUse)
+                oldest = cur;
+        }
+        m_archives.erase(oldest);
+    }
+    OpenArchive &slot = m_archives[key];
+    slot.archive = opened;
+    slot.lastUse = ++m_archiveClock;
+    return slot.archive;
+}
+
+bool TagRollupCache::statisticsFromArchive(const QDate &date, const DayStore::Signature &sig,
+                                           TagStatisticsMap &stats)
+{
+    const std::shared_ptr<const EventArchive> month = archiveFor(date);
+    if (!month || !month->dayMatches(date, sig))
+        return false;
+    const EventArchive &archive = *month;
+
+    // Как TagAnalyzer::accumulateStatistics, но по колонкам архива
+    const int first = archive.firstRowOfDay(date);
+    const int count = archive.rowCountOfDay(date);
+    const qint16  *starts = archive.startColumn() + first;
+    const qint16  *ends   = archive.endColumn() + first;
+    const quint32 *tags   = archive.tagColumn() + first;
+    for (int i = 0; i < count; ++i) {
+        if (starts[i] < 0 || ends[i] < 0)
+            continue;
+        Session session;
+        session.minutes = ends[i] - starts[i];
+        if (session.minutes < 0)
+            session.minutes += 24 * 60; // переход через полночь
+        session.date = date;
+        session.start = QTime(starts[i] / 60, starts[i] % 60);
+        stats[TagAnalyzer::tagLabel(archive.tag(tags[i]))].add(session);
+    }
+    return true;
+}
+
+int TagRollupCache::hits() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_hits;
+}
+
+int TagRollupCache::misses() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_misses;
+}
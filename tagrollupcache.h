@@ -0,0 +1,82 @@
+#ifndef TAGROLLUPCACHE_H
+#define TAGROLLUPCACHE_H
+
+#include <QDate>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <memory>
+#include "daystore.h"
+#include "tagstatistics.h"
+
+class EventArchive;
+
+// Сохраняемый на диск кэш сумм минут по тегам за каждый день каталога данных
+// (dataDir/archive/rollups.dat). Вместе с суммой хранится статистика сессий
+// дня (TagStatistics: эскиз длительностей и самые длинные) — она сливается,
+// поэтому квантили за годы стоят столько же, сколько и суммы. Запись дня действительна, пока не изменилась
+// подпись его файлов (DayStore::Signature); иначе день разбирается заново.
+// Исторические дни почти не меняются, поэтому повторный анализ многолетних
+// диапазонов сводится к чтению этого файла и stat() по дням.
+// Промах сначала ищет день в уже записанном помесячном архиве (EventArchive)
+// — если строки дня там собраны из тех же файлов, JSON не разбирается.
+// Архив при этом не пересобирается; за время жизни кэша архив месяца
+// отображается один раз, а не на каждый день-промах.
+// Потокобезопасен: dayTotals() можно звать из нескольких потоков.
+class TagRollupCache
+{
+public:
+    explicit TagRollupCache(const QString &dataDir);
+
+    static QString cachePath(const QString &dataDir);
+
+    // Чтение кэша с диска; отсутствующий или несовместимый файл — пустой кэш.
+    // Без явного вызова кэш читается при первом запросе дня.
+    void load();
+    // Брать ли дни-промахи из помесячного архива (по умолчанию — да)
+    void setUseArchive(bool on) { m_useArchive = on; }
+    // Запись на диск, только если были изменения
+    bool save(QString *errorString = nullptr);
+
+    // Суммы по тегам за день (подписи тегов — TagAnalyzer::tagLabel).
+    // sig — текущая подпись файлов дня, снятая вызывающим.
+    QMap<QString, int> dayTotals(const QDate &date, const DayStore::Signature &sig);
+    // Статистика сессий по тегам за день; подпись — как для dayTotals()
+    TagStatisticsMap dayStatistics(const QDate &date, const DayStore::Signature &sig);
+
+    int hits() const;
+    int misses() const;
+
+private:
+    struct Entry {
+        DayStore::Signature sig;
+        TagStatisticsMap stats;
+    };
+
+    struct OpenArchive {
+        std::shared_ptr<const EventArchive> archive;    // nullptr — архива нет или он битый
+        quint64 lastUse = 0;
+    };
+
+    DayStore m_store;
+    QHash<qint64, Entry> m_days;    // ключ — юлианский день
+    bool m_useArchive = true;
+    bool m_loaded = false;
+    bool m_dirty = false;
+    int m_hits = 0;
+    int m_misses = 0;
+    QHash<qint64, OpenArchive> m_archives;  // ключ — юлианский день 1-го числа месяца
+    quint64 m_archiveClock = 0;
+    mutable QMutex m_mutex;
+
+    void loadLocked();
+
+    // Отображённый архив месяца даты (открывается при первом обращении)
+    std::shared_ptr<const EventArchive> archiveFor(const QDate &date);
+    // Статистика дня из архива месяца; false — архива нет или день в нём устарел
+    bool statisticsFromArchive(const QDate &date, const DayStore::Signature &sig,
+                               TagStatisticsMap &stats);
+};
+
+#endif // TAGROLLUPCACHE_H
@@ -0,0 +1,103 @@
+#include "tagstatistics.h"
+
+#include <algorithm>
+
+bool TopSessions::longer(const Session &a, const Session &b)
+{
+    if (a.minutes != b.minutes)
+        return a.minutes > b.minutes;
+    if (a.date != b.date)
+        return a.date < b.date;
+    return a.start < b.start;
+}
+
+void TopSessions::add(const Session &session)
+{
+    // Наверху кучи — самая короткая из оставленных
+    if (m_heap.size() < m_capacity) {
+        m_heap.append(session);
+        std::push_heap(m_heap.begin(), m_heap.end(), longer);
+        return;
+    }
+    if (!longer(session, m_heap.first()))
+        return;
+    std::pop_heap(m_heap.begin(), m_heap.end(), longer);
+    m_heap.last() = session;
+    std::push_heap(m_heap.begin(), m_heap.end(), longer);
+}
+
+void TopSessions::merge(const TopSessions &other)
+{
+    for (const Session &session : other.m_heap)
+        add(session);
+}
+
+QVector<Session> TopSessions::sorted() const
+{
+    QVector<Session> result = m_heap;
+    std::sort(result.begin(), result.end(), longer);
+    return result;
+}
+
+QDataStream &operator<<(QDataStream &out, const TopSessions &top)
+{
+    out << qint32(top.m_capacity) << quint32(top.m_heap.size());
+    for (const Session &s : top.m_heap)
+        out << qint32(s.minutes) << qint64(s.date.toJulianDay()) << qint32(s.start.msecsSinceStartOfDay());
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, TopSessions &top)
+{
+    qint32 capacity = 0;
+    quint32 count = 0;
+    in >> capacity >> count;
+    top.m_capacity = qMax(1, int(capacity));
+    top.m_heap.clear();
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        qint32 minutes = 0, start = 0;
+        qint64 julianDay = 0;
+        in >> minutes >> julianDay >> start;
+        Session s;
+        s.minutes = minutes;
+        s.date = QDate::fromJulianDay(julianDay);
+        s.start = QTime::fromMSecsSinceStartOfDay(start);
+        top.add(s);
+    }
+    return in;
+}
+
+void TagStatistics::add(const Session &session)
+{
+    ++sessions;
+    minutes += session.minutes;
+    durations.add(session.minutes);
+    longest.add(session);
+}
+
+void TagStatistics::merge(const TagStatistics &other)
+{
+    sessions += other.sessions;
+    minutes += other.minutes;
+    durations.merge(other.durations);
+    longest.merge(other.longest);
+}
+
+void mergeStatistics(TagStatisticsMap &result, const TagStatisticsMap &part)
+{
+    for (auto it = part.constBegin(); it != part.constEnd(); ++it)
+        result[it.key()].merge(it.value());
+}
+
+QDataStream &operator<<(QDataStream &out, const TagStatistics &stats)
+{
+    return out << qint32(stats.sessions) << stats.minutes << stats.durations << stats.longest;
+}
+
+QDataStream &operator>>(QDataStream &in, TagStatistics &stats)
+{
+    qint32 sessions = 0;
+    in >> sessions >> stats.minutes >> stats.durations >> stats.longest;
+    stats.sessions = sessions;
+    return in;
+}
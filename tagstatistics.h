@@ -0,0 +1,66 @@
+#ifndef TAGSTATISTICS_H
+#define TAGSTATISTICS_H
+
+#include <QDataStream>
+#include <QDate>
+#include <QMap>
+#include <QString>
+#include <QTime>
+#include <QVector>
+#include "durationdigest.h"
+
+// Одна сессия (событие) для списка самых длинных. Название в кэше не
+// хранится — его дочитывает TagAnalyzer::longestSessions() для итогового списка.
+struct Session {
+    int minutes = 0;
+    QDate date;
+    QTime start;
+    QString title;
+};
+
+// K самых длинных сессий: куча с наименьшей наверху, не больше capacity
+// элементов. Сливается с другой такой же — результат тот же, что у одного
+// прохода по всем сессиям. При равной длине раньше идёт более ранняя сессия.
+class TopSessions
+{
+public:
+    explicit TopSessions(int capacity = 5) : m_capacity(qMax(1, capacity)) {}
+
+    void add(const Session &session);
+    void merge(const TopSessions &other);
+
+    // По убыванию длительности
+    QVector<Session> sorted() const;
+    int size() const { return m_heap.size(); }
+
+    friend QDataStream &operator<<(QDataStream &out, const TopSessions &top);
+    friend QDataStream &operator>>(QDataStream &in, TopSessions &top);
+
+private:
+    int m_capacity;
+    QVector<Session> m_heap;
+
+    // a «длиннее» b: длиннее, а при равенстве — раньше
+    static bool longer(const Session &a, const Session &b);
+};
+
+// Сессии одного тега: число, сумма, распределение длительностей, самые длинные
+struct TagStatistics {
+    int sessions = 0;
+    qint64 minutes = 0;
+    DurationDigest durations;
+    TopSessions longest;
+
+    void add(const Session &session);
+    void merge(const TagStatistics &other);
+};
+
+// Ключ — подпись тега (TagAnalyzer::tagLabel)
+using TagStatisticsMap = QMap<QString, TagStatistics>;
+
+void mergeStatistics(TagStatisticsMap &result, const TagStatisticsMap &part);
+
+QDataStream &operator<<(QDataStream &out, const TagStatistics &stats);
+QDataStream &operator>>(QDataStream &in, TagStatistics &stats);
+
+#endif // TAGSTATISTICS_H
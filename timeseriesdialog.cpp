@@ -0,0 +1,209 @@
+#include "timeseriesdialog.h"
+#include "downsampler.h"
+#include "trace.h"
+
+#include <QComboBox>
+#include <QDateTime>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <QtConcurrent>
+#include <algorithm>
+
+namespace {
+
+qint64 msecsOf(const QDate &date)
+{
+    return QDateTime(date, QTime(0, 0)).toMSecsSinceEpoch();
+}
+
+const qint64 kDayMs = 24 * 60 * 60 * 1000;
+
+} // namespace
+
+TimeSeriesDialog::TimeSeriesDialog(const QStringList &dataDirs, QWidget *parent)
+    : QDialog(parent)
+    , m_dataDirs(dataDirs)
+{
+    setWindowTitle(tr("Динамика по тегам"));
+    resize(960, 560);
+
+    m_chart = new QChart;
+    m_chart->legend()->setAlignment(Qt::AlignRight);
+    m_axisX = new QDateTimeAxis;
+    m_axisX->setFormat(QStringLiteral("dd.MM.yyyy"));
+    m_axisY = new QValueAxis;
+    m_axisY->setTitleText(tr("минуты"));
+    m_axisY->setLabelFormat(QStringLiteral("%d"));
+    m_chart->addAxis(m_axisX, Qt::AlignBottom);
+    m_chart->addAxis(m_axisY, Qt::AlignLeft);
+
+    m_view = new QChartView(m_chart, this);
+    m_view->setRenderHint(QPainter::Antialiasing);
+    m_view->setRubberBand(QChartView::HorizontalRubberBand);  // выделение — увеличение, ПКМ — назад
+
+    m_levelBox = new QComboBox(this);
+    m_levelBox->addItems({ tr("Авто"), tr("По дням"), tr("По неделям"), tr("По месяцам") });
+    auto *resetButton = new QPushButton(tr("Весь период"), this);
+    m_status = new QLabel(tr("Подсчёт…"), this);
+
+    auto *controls = new QHBoxLayout;
+    controls->addWidget(new QLabel(tr("Детализация:"), this));
+    controls->addWidget(m_levelBox);
+    controls->addWidget(resetButton);
+    controls->addStretch();
+    controls->addWidget(m_status);
+
+    auto *layout = new QVBoxLayout(this);
+    layout->addLayout(controls);
+    layout->addWidget(m_view);
+
+    m_refreshTimer.setSingleShot(true);
+    m_refreshTimer.setInterval(30);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &TimeSeriesDialog::refreshVisible);
+    connect(m_axisX, &QDateTimeAxis::rangeChanged, &m_refreshTimer,
+            static_cast<void (QTimer::*)()>(&QTimer::start));
+    connect(m_levelBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            &m_refreshTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    connect(resetButton, &QPushButton::clicked, this, &TimeSeriesDialog::resetZoom);
+    connect(&m_watcher, &QFutureWatcher<TagAnalyzer::DailySeries>::finished,
+            this, &TimeSeriesDialog::onSeriesLoaded);
+
+    // Вся история: от первого до последнего дня с файлами. Границы тоже
+    // ищутся в фоне — на большом каталоге это обход манифеста или файлов.
+    // Задача не ссылается на диалог: закрытый до конца подсчёта диалог её
+    // не ждёт, она доработает сама и сохранит кэш
+    const QStringList dirs = m_dataDirs;
+    m_watcher.setFuture(QtConcurrent::run([dirs]() {
+        const TagAnalyzer analyzer(dirs);
+        QDate first, last;
+        if (!analyzer.dataRange(&first, &last))
+            return TagAnalyzer::DailySeries();
+        return analyzer.dailySeries(first, last);
+    }));
+}
+
+void TimeSeriesDialog::onSeriesLoaded()
+{
+    const TagAnalyzer::DailySeries daily = m_watcher.result();
+    const int dayCount = daily.dayCount();
+    if (dayCount == 0) {
+        m_status->setText(tr("Нет данных"));
+        return;
+    }
+
+    // Три уровня детализации — один проход по дням на тег
+    m_rows.resize(daily.tags.size());
+    for (int t = 0; t < daily.tags.size(); ++t) {
+        TagRows &rows = m_rows[t];
+        rows.tag = daily.tags.at(t);
+        const QVector<int> &minutes = daily.minutes.at(t);
+
+        rows.levels[Days].reserve(dayCount);
+
+        QDate week, month;
+        for (int d = 0; d < dayCount; ++d) {
+            const QDate date = daily.first.addDays(d);
+            rows.levels[Days].append(QPointF(msecsOf(date), minutes.at(d)));
+
+            const QDate weekStart = date.addDays(1 - date.dayOfWeek());
+            if (weekStart != week) {
+                week = weekStart;
+                rows.levels[Weeks].append(QPointF(msecsOf(week), 0));
+            }
+            rows.levels[Weeks].last().ry() += minutes.at(d);
+
+            const QDate monthStart(date.year(), date.month(), 1);
+            if (monthStart != month) {
+                month = monthStart;
+                rows.levels[Months].append(QPointF(msecsOf(month), 0));
+            }
+            rows.levels[Months].last().ry() += minutes.at(d);
+        }
+
+        rows.series = new QLineSeries;
+        rows.series->setName(rows.tag);
+        m_chart->addSeries(rows.series);
+        rows.series->attachAxis(m_axisX);
+        rows.series->attachAxis(m_axisY);
+    }
+
+    m_fullFrom = msecsOf(daily.first);
+    m_fullTo = msecsOf(daily.first.addDays(dayCount - 1));
+    resetZoom();
+}
+
+void TimeSeriesDialog::resetZoom()
+{
+    if (m_rows.isEmpty())
+        return;
+    m_chart->zoomReset();
+    m_axisX->setRange(QDateTime::fromMSecsSinceEpoch(m_fullFrom),
+                      QDateTime::fromMSecsSinceEpoch(qMax(m_fullTo, m_fullFrom + kDayMs)));
+    m_refreshTimer.start();
+}
+
+void TimeSeriesDialog::resizeEvent(QResizeEvent *event)
+{
+    QDialog::resizeEvent(event);
+    m_refreshTimer.start();     // другая ширина — другое число точек
+}
+
+TimeSeriesDialog::Level TimeSeriesDialog::levelForSpan(qint64 spanMs, int pixels) const
+{
+    // Самый мелкий уровень, у которого видимых точек не больше двух на пиксель
+    const qint64 days = spanMs / kDayMs + 1;
+    if (days <= 2 * pixels)
+        return Days;
+    if (days / 7 <= 2 * pixels)
+        return Weeks;
+    return Months;
+}
+
+QVector<QPointF> TimeSeriesDialog::slice(const QVector<QPointF> &points, qint64 from, qint64 to)
+{
+    // По одной точке за краями — чтобы линия доходила до границ графика
+    auto first = std::lower_bound(points.cbegin(), points.cend(), double(from),
+                                  [](const QPointF &p, double x) { return p.x() < x; });
+    auto last = std::upper_bound(points.cbegin(), points.cend(), double(to),
+                                 [](double x, const QPointF &p) { return x < p.x(); });
+    if (first != points.cbegin())
+        --first;
+    if (last != points.cend())
+        ++last;
+    const int start = int(first - points.cbegin());
+    return points.mid(start, int(last - first));
+}
+
+void TimeSeriesDialog::refreshVisible()
+{
+    if (m_rows.isEmpty())
+        return;
+    TRACE_SCOPE_CAT("TimeSeriesDialog::refreshVisible", "ui");
+
+    const qint64 from = m_axisX->min().toMSecsSinceEpoch();
+    const qint64 to = m_axisX->max().toMSecsSinceEpoch();
+    const int pixels = qMax(16, int(m_chart->plotArea().width()));
+
+    const int chosen = m_levelBox->currentIndex();
+    const Level level = (chosen <= 0) ? levelForSpan(to - from, pixels) : Level(chosen - 1);
+
+    double maxY = 0;
+    int pointCount = 0;
+    for (TagRows &rows : m_rows) {
+        QVector<QPointF> points = slice(rows.levels[level], from, to);
+        if (points.size() > pixels)
+            points = Downsampler::lttb(points, pixels);
+        for (const QPointF &p : points)
+            maxY = qMax(maxY, p.y());
+        pointCount += points.size();
+        rows.series->replace(points);   // одна перерисовка вместо append по точке
+    }
+    m_axisY->setRange(0, maxY > 0 ? maxY * 1.05 : 1);
+
+    static const char *const kLevelNames[] = { QT_TR_NOOP("по дням"), QT_TR_NOOP("по неделям"),
+                                               QT_TR_NOOP("по месяцам") };
+    m_status->setText(tr("Детализация: %1, точек на графике: %2")
+                          .arg(tr(kLevelNames[level])).arg(pointCount));
+}
@@ -0,0 +1,73 @@
+#ifndef TIMESERIESDIALOG_H
+#define TIMESERIESDIALOG_H
+
+#include <QDialog>
+#include <QFutureWatcher>
+#include <QPointF>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+#include <QtCharts/QChartView>
+#include <QtCharts/QDateTimeAxis>
+#include <QtCharts/QLineSeries>
+#include <QtCharts/QValueAxis>
+#include "taganalyzer.h"
+
+class QComboBox;
+class QLabel;
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+QT_CHARTS_USE_NAMESPACE
+#endif
+
+// Динамика минут по тегам за всю историю (Qt Charts). Суммы по дням
+// считаются один раз в фоне (TagAnalyzer::dailySeries), из них заранее
+// собираются ряды по дням, неделям и месяцам. В QLineSeries уходит только
+// видимый кусок нужной детализации, прореженный (LTTB) до ширины графика:
+// при увеличении (выделение мышью) запрашивается более мелкий уровень.
+class TimeSeriesDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit TimeSeriesDialog(const QStringList &dataDirs, QWidget *parent = nullptr);
+
+protected:
+    void resizeEvent(QResizeEvent *event) override;
+
+private slots:
+    void onSeriesLoaded();
+    void refreshVisible();
+
+private:
+    enum Level { Days, Weeks, Months, LevelCount };
+
+    struct TagRows {
+        QString tag;
+        QVector<QPointF> levels[LevelCount];    // x — мс от эпохи (начало корзины), y — минуты
+        QLineSeries *series = nullptr;
+    };
+
+    QStringList m_dataDirs;
+    QChart *m_chart = nullptr;
+    QChartView *m_view = nullptr;
+    QDateTimeAxis *m_axisX = nullptr;
+    QValueAxis *m_axisY = nullptr;
+    QComboBox *m_levelBox = nullptr;
+    QLabel *m_status = nullptr;
+
+    QFutureWatcher<TagAnalyzer::DailySeries> m_watcher;
+    QVector<TagRows> m_rows;
+    qint64 m_fullFrom = 0;
+    qint64 m_fullTo = 0;
+
+    // Изменения оси при выделении/прокрутке приходят пачками — пересчёт один
+    QTimer m_refreshTimer;
+
+    void resetZoom();
+    Level levelForSpan(qint64 spanMs, int pixels) const;
+
+    static QVector<QPointF> slice(const QVector<QPointF> &points, qint64 from, qint64 to);
+};
+
+#endif // TIMESERIESDIALOG_H
@@ -0,0 +1,204 @@
+#include "trace.h"
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+#include <QVector>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+struct Record {
+    char phase;             // 'X' — интервал, 'C' — значение счётчика
+    const char *name;
+    const char *category;
+    qint64 ts;              // нс от старта
+    qint64 value;           // длительность (нс) или значение счётчика
+};
+
+// Буфер одного потока. Пишет в него только свой поток, читает — finish();
+// мьютекс почти всегда свободен.
+struct ThreadBuffer {
+    QMutex mutex;
+    QVector<Record> records;
+    int tid = 0;
+    QString threadName;
+};
+
+const char *const kCounterNames[Trace::CounterCount] = {
+    "files_read", "files_written", "bytes_parsed", "cache_hits", "cache_misses"
+};
+
+QElapsedTimer g_clock;
+QString g_outputPath;
+std::atomic<qint64> g_counters[Trace::CounterCount];
+
+// Буферы живут до конца процесса: потоки пула могут завершиться раньше выгрузки
+QMutex g_registryMutex;
+QVector<ThreadBuffer *> g_buffers;
+thread_local ThreadBuffer *t_buffer = nullptr;
+
+ThreadBuffer *threadBuffer()
+{
+    if (!t_buffer) {
+        auto *buffer = new ThreadBuffer;
+        buffer->records.reserve(1024);
+        const QThread *thread = QThread::currentThread();
+        buffer->threadName = thread ? thread->objectName() : QString();
+        QMutexLocker locker(&g_registryMutex);
+        buffer->tid = g_buffers.size() + 1;
+        if (buffer->threadName.isEmpty()) {
+            const QCoreApplication *app = QCoreApplication::instance();
+            buffer->threadName = (app && app->thread() == thread)
+                                     ? QStringLiteral("main")
+                                     : QStringLiteral("thread %1").arg(buffer->tid);
+        }
+        g_buffers.append(buffer);
+        t_buffer = buffer;
+    }
+    return t_buffer;
+}
+
+void append(const Record &record)
+{
+    ThreadBuffer *buffer = threadBuffer();
+    QMutexLocker locker(&buffer->mutex);
+    buffer->records.append(record);
+}
+
+// Микросекунды с дробной частью — так ожидает trace_event
+QByteArray micros(qint64 nanoseconds)
+{
+    return QByteArray::number(nanoseconds / 1000.0, 'f', 3);
+}
+
+QByteArray jsonString(const QString &value)
+{
+    QByteArray escaped = value.toUtf8();
+    escaped.replace('\\', "\\\\").replace('"', "\\\"");
+    return '"' + escaped + '"';
+}
+
+} // namespace
+
+bool Trace::configure(int argc, char *argv[])
+{
+    QString path;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            path = QString::fromLocal8Bit(argv[i + 1]);
+            break;
+        }
+        if (std::strncmp(argv[i], "--trace=", 8) == 0) {
+            path = QString::fromLocal8Bit(argv[i] + 8);
+            break;
+        }
+    }
+    if (path.isEmpty())
+        path = qEnvironmentVariable("TIMETRACKER_TRACE");
+    if (path.isEmpty())
+        return false;
+
+    start(path);
+    return true;
+}
+
+void Trace::start(const QString &outputPath)
+{
+    g_outputPath = outputPath;
+    for (std::atomic<qint64> &counter : g_counters)
+        counter.store(0, std::memory_order_relaxed);
+    g_clock.start();
+    s_enabled.store(true, std::memory_order_release);
+}
+
+qint64 Trace::now()
+{
+    return g_clock.nsecsElapsed();
+}
+
+void Trace::record(const char *name, const char *category, qint64 start, qint64 duration)
+{
+    append({ 'X', name, category, start, duration });
+}
+
+void Trace::addToCounter(Counter counter, qint64 delta)
+{
+    // Значение после прибавки — точка на графике счётчика
+    const qint64 value = g_counters[counter].fetch_add(delta, std::memory_order_relaxed) + delta;
+    append({ 'C', kCounterNames[counter], "counter", now(), value });
+}
+
+bool Trace::finish(QString *errorString)
+{
+    if (!isEnabled())
+        return true;
+    s_enabled.store(false, std::memory_order_release);
+
+    QSaveFile file(g_outputPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorString)
+            *errorString = "Не удалось открыть файл трассировки: " + g_outputPath + "\n" + file.errorString();
+        return false;
+    }
+
+    // Пишем по мере обхода: трасса длинной сессии бывает на сотни мегабайт
+    QByteArray chunk = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto flushChunk = [&]() {
+        file.write(chunk);
+        chunk.clear();
+    };
+
+    QMutexLocker registryLocker(&g_registryMutex);
+    for (ThreadBuffer *buffer : std::as_const(g_buffers)) {
+        QMutexLocker locker(&buffer->mutex);
+        const QByteArray tid = QByteArray::number(buffer->tid);
+
+        chunk += first ? "" : ",\n";
+        first = false;
+        chunk += "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" + tid
+                 + ",\"args\":{\"name\":" + jsonString(buffer->threadName) + "}}";
+
+        for (const Record &r : std::as_const(buffer->records)) {
+            chunk += ",\n{\"ph\":\"";
+            chunk += r.phase;
+            chunk += "\",\"name\":\"";
+            chunk += r.name;
+            chunk += "\",\"cat\":\"";
+            chunk += r.category;
+            chunk += "\",\"pid\":1,\"tid\":" + tid + ",\"ts\":" + micros(r.ts);
+            if (r.phase == 'X')
+                chunk += ",\"dur\":" + micros(r.value) + "}";
+            else
+                chunk += ",\"args\":{\"value\":" + QByteArray::number(r.value) + "}}";
+            if (chunk.size() > (1 << 20))
+                flushChunk();
+        }
+        buffer->records.clear();
+    }
+
+    // Итоги счётчиков — в метаданные трассы
+    chunk += "\n],\"otherData\":{";
+    for (int c = 0; c < CounterCount; ++c) {
+        if (c > 0)
+            chunk += ',';
+        chunk += '"';
+        chunk += kCounterNames[c];
+        chunk += "\":\"" + QByteArray::number(g_counters[c].load(std::memory_order_relaxed)) + '"';
+    }
+    chunk += "}}\n";
+    flushChunk();
+
+    if (!file.commit()) {
+        if (errorString)
+            *errorString = "Не удалось записать файл трассировки: " + g_outputPath + "\n" + file.errorString();
+        return false;
+    }
+    return true;
+}
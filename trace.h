@@ -0,0 +1,79 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+
+// Встроенная трассировка: интервалы (TRACE_SCOPE) и счётчики (Trace::count)
+// пишутся в буферы потоков и при выходе выгружаются в формате Chrome
+// trace_event (открывается в chrome://tracing или ui.perfetto.dev).
+// Включается ключом --trace файл.json или переменной окружения
+// TIMETRACKER_TRACE=файл.json; выключенная трассировка — одна проверка флага.
+class Trace
+{
+public:
+    enum Counter {
+        FilesRead,      // прочитанные файлы дней (снимки и журналы)
+        FilesWritten,   // записанные снимки и дозаписи журналов
+        BytesParsed,    // байты JSON, прошедшие через разбор
+        CacheHits,      // попадания в кэши (DayCache, TagRollupCache)
+        CacheMisses,
+        CounterCount
+    };
+
+    // Ключ командной строки или переменная окружения; true — трассировка включена
+    static bool configure(int argc, char *argv[]);
+    // Включить трассировку с выгрузкой в outputPath (отсчёт времени — отсюда)
+    static void start(const QString &outputPath);
+    // Выгрузка собранного в файл; выключенная трассировка — сразу true
+    static bool finish(QString *errorString = nullptr);
+
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    static void count(Counter counter, qint64 delta = 1)
+    {
+        if (isEnabled())
+            addToCounter(counter, delta);
+    }
+
+    // Интервал от конструктора до деструктора. name и category — строковые
+    // литералы (хранятся указатели, в JSON попадают без экранирования).
+    class Span
+    {
+    public:
+        explicit Span(const char *name, const char *category = "core")
+            : m_name(isEnabled() ? name : nullptr)
+            , m_category(category)
+        {
+            if (m_name)
+                m_start = now();
+        }
+        ~Span()
+        {
+            if (m_name)
+                record(m_name, m_category, m_start, now() - m_start);
+        }
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+
+    private:
+        const char *m_name;
+        const char *m_category;
+        qint64 m_start = 0;
+    };
+
+private:
+    static inline std::atomic<bool> s_enabled { false };
+
+    static qint64 now();    // нс от start()
+    static void record(const char *name, const char *category, qint64 start, qint64 duration);
+    static void addToCounter(Counter counter, qint64 delta);
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) Trace::Span TRACE_CONCAT(traceSpan_, __LINE__)(name)
+#define TRACE_SCOPE_CAT(name, category) Trace::Span TRACE_CONCAT(traceSpan_, __LINE__)(name, category)
+
+#endif // TRACE_H